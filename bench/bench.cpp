@@ -0,0 +1,280 @@
+
+// built-in
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// extern
+#include <benchmark/benchmark.h>
+
+// local
+#include "corpus.hpp"
+#include "event.hpp"
+#include "lexer.hpp"
+#include "token_stream.hpp"
+#include "js_parser.hpp"
+#include "tree_releaser.hpp"
+#include "cgen.hpp"
+#include "source_buffer.hpp"
+
+
+
+//
+//  Benchmarks
+//
+//
+//  Throughput of every pass (bytes and tokens per second) on synthetic
+//  corpora (see 'generate_corpus'). Every benchmark takes the shape of
+//  its corpus as arguments: size in MB, nesting depth, expression
+//  density and comment ratio.
+//
+//  The lexer is measured as the parser drives it (token by token, with
+//  'Lexer::next'), and the passes after it on a tree parsed beforehand.
+//
+//  'batch' compiles many small files with names of their own, like a
+//  project would, to catch per-file costs that grow with the symbols
+//  interned by the whole process (which one large corpus never shows).
+//
+
+
+struct Corpus
+{
+    std::string text; // followed by the padding the lexer needs
+    size_t size;
+    uint64_t tokens;
+
+    std::string_view source() const
+    {
+        return {this->text.data(), this->size};
+    }
+};
+
+
+static std::unique_ptr<Corpus> make_corpus(const CorpusShape& shape)
+{
+    auto corpus = std::make_unique<Corpus>();
+    corpus->text = generate_corpus(shape);
+    corpus->size = corpus->text.size();
+    corpus->text.append(SourceBuffer::padding, '\0');
+
+    EventHandler eh;
+    Lexer lexer {corpus->source(), eh, "corpus.js"};
+
+    corpus->tokens = 0;
+    while (lexer.next().type != TokenType::lEOF)
+        corpus->tokens++;
+
+    return corpus;
+}
+
+
+// corpora are generated once per shape and kept for the benchmarks after
+static const Corpus& corpus_for(const benchmark::State& state)
+{
+    static std::map<std::tuple<int64_t, int64_t, int64_t, int64_t>, std::unique_ptr<Corpus>> corpora;
+
+    auto& corpus = corpora[{state.range(0), state.range(1), state.range(2), state.range(3)}];
+    if (corpus == nullptr)
+    {
+        CorpusShape shape;
+        shape.size = (size_t)state.range(0) << 20;
+        shape.nesting_depth = state.range(1);
+        shape.expression_density = state.range(2);
+        shape.comment_ratio = state.range(3);
+
+        corpus = make_corpus(shape);
+    }
+
+    return *corpus;
+}
+
+
+// the files of a batch (number of files and KB per file), each with its own seed and names
+static const std::vector<std::unique_ptr<Corpus>>& batch_for(const benchmark::State& state)
+{
+    static std::map<std::pair<int64_t, int64_t>, std::vector<std::unique_ptr<Corpus>>> batches;
+
+    auto& files = batches[{state.range(0), state.range(1)}];
+    if (files.empty())
+    {
+        for (int64_t file = 0; file < state.range(0); file++)
+        {
+            CorpusShape shape;
+            shape.size = (size_t)state.range(1) << 10;
+            shape.seed = file + 1;
+            shape.prefix = "f" + std::to_string(file) + "_";
+
+            files.push_back(make_corpus(shape));
+        }
+    }
+
+    return files;
+}
+
+
+// the tree refers to the source through the lexer, which must outlive it
+static Program* parse(Lexer& lexer, EventHandler& eh)
+{
+    TokenStream tokens {lexer};
+
+    return JSParser(tokens, eh)();
+}
+
+
+static void report_throughput(benchmark::State& state, const Corpus& corpus)
+{
+    state.SetBytesProcessed(state.iterations() * corpus.size);
+    state.counters["tokens"] = benchmark::Counter(state.iterations() * corpus.tokens, benchmark::Counter::kIsRate);
+}
+
+
+
+static void lexer(benchmark::State& state)
+{
+    const Corpus& corpus = corpus_for(state);
+
+    for (auto _: state)
+    {
+        EventHandler eh;
+        Lexer lexer {corpus.source(), eh, "corpus.js"};
+
+        uint64_t tokens = 0;
+        while (lexer.next().type != TokenType::lEOF)
+            tokens++;
+
+        benchmark::DoNotOptimize(tokens);
+    }
+
+    report_throughput(state, corpus);
+}
+
+
+static void parser(benchmark::State& state)
+{
+    const Corpus& corpus = corpus_for(state);
+
+    for (auto _: state)
+    {
+        EventHandler eh;
+        Lexer lexer {corpus.source(), eh, "corpus.js"};
+        Program* prog = parse(lexer, eh);
+
+        state.PauseTiming();
+        if (eh.has_error())
+            state.SkipWithError("the corpus has errors");
+        release_program(prog);
+        state.ResumeTiming();
+    }
+
+    report_throughput(state, corpus);
+}
+
+
+static void codegen(benchmark::State& state)
+{
+    const Corpus& corpus = corpus_for(state);
+
+    EventHandler eh;
+    Lexer lexer {corpus.source(), eh, "corpus.js"};
+    Program* prog = parse(lexer, eh);
+
+    for (auto _: state)
+    {
+        // without a file, the code stays in memory
+        CodeBuffer code {corpus.size};
+        gen_gdscript(prog, code);
+
+        benchmark::DoNotOptimize(code.view().data());
+    }
+
+    release_program(prog);
+    report_throughput(state, corpus);
+}
+
+
+//  Releasing takes much less than parsing the tree to release, so it is
+//  timed by hand in a fixed number of iterations (otherwise the library
+//  would parse until the release time adds up to its minimum time).
+static void release(benchmark::State& state)
+{
+    const Corpus& corpus = corpus_for(state);
+
+    for (auto _: state)
+    {
+        EventHandler eh;
+        Lexer lexer {corpus.source(), eh, "corpus.js"};
+        Program* prog = parse(lexer, eh);
+
+        const auto start = std::chrono::steady_clock::now();
+        release_program(prog);
+        const auto end = std::chrono::steady_clock::now();
+
+        state.SetIterationTime(std::chrono::duration<double>(end - start).count());
+    }
+
+    report_throughput(state, corpus);
+}
+
+
+//  Every pass on each file of a batch, in sequence, like 'jts2gd -J 1'
+//  does. The time per file should not depend on the number of files.
+static void batch(benchmark::State& state)
+{
+    const auto& files = batch_for(state);
+
+    uint64_t bytes = 0;
+    for (const auto& corpus: files)
+        bytes += corpus->size;
+
+    for (auto _: state)
+    {
+        for (const auto& corpus: files)
+        {
+            EventHandler eh;
+            Lexer lexer {corpus->source(), eh, "corpus.js"};
+            Program* prog = parse(lexer, eh);
+
+            CodeBuffer code {corpus->size};
+            gen_gdscript(prog, code);
+            benchmark::DoNotOptimize(code.view().data());
+
+            release_program(prog);
+        }
+    }
+
+    state.SetBytesProcessed(state.iterations() * bytes);
+    state.counters["files"] = benchmark::Counter(state.iterations() * files.size(), benchmark::Counter::kIsRate);
+}
+
+
+// the default shape at every size, then variations of each parameter at 1 MB
+static void shapes(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({"mb", "depth", "density", "comments"});
+    benchmark->Unit(benchmark::kMillisecond);
+
+    for (int64_t mb: {1, 10, 100})
+        benchmark->Args({mb, 3, 50, 10});
+
+    benchmark->Args({1, 1, 50, 10});
+    benchmark->Args({1, 8, 50, 10});
+    benchmark->Args({1, 3, 10, 10});
+    benchmark->Args({1, 3, 90, 10});
+    benchmark->Args({1, 3, 50, 0});
+    benchmark->Args({1, 3, 50, 50});
+}
+
+
+BENCHMARK(lexer)->Apply(shapes);
+BENCHMARK(parser)->Apply(shapes);
+BENCHMARK(codegen)->Apply(shapes);
+BENCHMARK(release)->Apply(shapes)->UseManualTime()->Iterations(16);
+BENCHMARK(batch)->ArgNames({"files", "kb"})->Args({10, 16})->Args({100, 16})->Args({1000, 16})->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
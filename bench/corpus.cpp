@@ -0,0 +1,205 @@
+
+// built-in
+#include <algorithm>
+#include <random>
+#include <string_view>
+
+// local
+#include "corpus.hpp"
+
+
+
+static constexpr std::string_view operands[]
+{
+    "delta", "P_SPEED", "B_SPEED", "player1.position.y", "player2.position.y",
+    "ball.position.x", "ball.position.y", "player1.size.y", "ball_dir.x", "720", "1280", "2"
+};
+
+static constexpr std::string_view operators[] {" + ", " - ", " * ", " / "};
+static constexpr std::string_view comparisons[] {" > ", " < ", " >= ", " <= ", " == "};
+static constexpr std::string_view assignments[] {" = ", " += ", " -= ", " *= "};
+static constexpr std::string_view targets[] {"player1.position.y", "player2.position.y", "ball.position.x", "ball.position.y"};
+static constexpr std::string_view colors[] {"Color.blue", "Color.red", "Color.black"};
+
+static constexpr std::string_view members
+{
+    "\tvar player1 = Rect2(Vector2(100,360),Vector2(25,100))\n"
+    "\tvar player2 = Rect2(Vector2(1180,360),Vector2(25,100))\n"
+    "\tvar P_SPEED:int = 500\n"
+    "\tvar B_SPEED:int = 1000\n"
+    "\n"
+    "\tvar ball = Rect2(Vector2(640,360),Vector2(15,15))\n"
+    "\tvar ball_dir = Vector2(1,0)\n"
+    "\n"
+};
+
+
+
+class CorpusWriter
+{
+    private:
+
+        const CorpusShape& shape;
+        std::string& out;
+        std::mt19937 random;
+        uint32_t variables = 0; // of the function being written, to give them unique names
+
+    public:
+
+        CorpusWriter(const CorpusShape& shape, std::string& out)
+        : shape(shape), out(out), random(shape.seed)
+        {
+        }
+
+        void write()
+        {
+            this->out.append("//gd class Generated extends Node2D\n{\n\n");
+            this->out.append(members);
+
+            for (uint32_t function = 0; this->out.size() < this->shape.size; function++)
+            {
+                this->variables = 0;
+
+                this->out.append("\tfunction ").append(this->shape.prefix).append("update_").append(std::to_string(function)).append("(delta)\n\t{\n");
+
+                for (uint32_t stmts = 4 + this->below(8); stmts > 0; stmts--)
+                    this->write_stmt(2, 1);
+
+                this->out.append("\t}\n\n");
+            }
+
+            this->out.append("}\n");
+        }
+
+    private:
+
+        uint32_t below(uint32_t limit)
+        {
+            return std::uniform_int_distribution<uint32_t>{0, limit - 1}(this->random);
+        }
+
+        bool percent(uint32_t chance)
+        {
+            return this->below(100) < chance;
+        }
+
+        template <size_t SIZE>
+        std::string_view pick(const std::string_view (&options)[SIZE])
+        {
+            return options[this->below(SIZE)];
+        }
+
+        void indent(uint32_t levels)
+        {
+            this->out.append(levels, '\t');
+        }
+
+        void write_stmt(uint32_t indentation, uint32_t depth)
+        {
+            if (this->percent(this->shape.comment_ratio))
+            {
+                this->indent(indentation);
+                this->out.append("// keeps the paddles and the ball inside the screen\n");
+            }
+
+            this->indent(indentation);
+
+            const uint32_t kind = this->below(depth <= this->shape.nesting_depth ? 5 : 4);
+            switch (kind)
+            {
+                case 0:
+                    this->out.append("var ").append(this->shape.prefix).append("v").append(std::to_string(this->variables++)).append(":float = ");
+                    this->write_expr(0);
+                    break;
+
+                case 1:
+                    this->out.append(this->pick(targets)).append(this->pick(assignments));
+                    this->write_expr(0);
+                    break;
+
+                case 2:
+                    this->out.append("draw_rect(player").append(this->percent(50) ? "1, " : "2, ").append(this->pick(colors)).append(")");
+                    break;
+
+                case 3:
+                    this->out.append("ball_dir = Vector2(1,0).rotated(");
+                    this->write_expr(0);
+                    this->out.append(")");
+                    break;
+
+                default:
+                    this->write_if(indentation, depth);
+                    return;
+            }
+
+            this->out.push_back('\n');
+        }
+
+        void write_if(uint32_t indentation, uint32_t depth)
+        {
+            this->out.append("if(");
+            this->write_expr(0);
+            this->out.append(this->pick(comparisons));
+            this->write_expr(0);
+            this->out.append(")\n");
+
+            this->write_block(indentation, depth);
+
+            if (this->percent(50))
+            {
+                this->indent(indentation);
+                this->out.append("else\n");
+                this->write_block(indentation, depth);
+            }
+        }
+
+        void write_block(uint32_t indentation, uint32_t depth)
+        {
+            this->indent(indentation);
+            this->out.append("{\n");
+
+            for (uint32_t stmts = 1 + this->below(3); stmts > 0; stmts--)
+                this->write_stmt(indentation + 1, depth + 1);
+
+            this->indent(indentation);
+            this->out.append("}\n");
+        }
+
+        // the density is the chance of adding one more operand (capped, so expressions end)
+        void write_expr(uint32_t nesting)
+        {
+            const uint32_t density = std::min<uint32_t>(this->shape.expression_density, 90);
+
+            this->write_operand(nesting);
+
+            while (this->percent(density))
+            {
+                this->out.append(this->pick(operators));
+                this->write_operand(nesting);
+            }
+        }
+
+        // parenthesized groups nest a few levels
+        void write_operand(uint32_t nesting)
+        {
+            if (nesting < 2 && this->percent(this->shape.expression_density / 4))
+            {
+                this->out.push_back('(');
+                this->write_expr(nesting + 1);
+                this->out.push_back(')');
+            }
+            else
+                this->out.append(this->pick(operands));
+        }
+};
+
+
+
+std::string generate_corpus(const CorpusShape& shape)
+{
+    std::string out;
+    out.reserve(shape.size + 4096);
+
+    CorpusWriter {shape, out}.write();
+    return out;
+}
@@ -0,0 +1,39 @@
+#ifndef JTS2GD_BENCH_CORPUS
+#define JTS2GD_BENCH_CORPUS
+
+
+// built-in
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+//
+//  Corpus generator
+//
+//
+//  Synthetic sources in the style of 'examples/pong.js' (a class with
+//  member variables and functions of nested ifs, typed variables,
+//  member assignments and calls) of any size, to measure the passes on
+//  inputs larger than the examples.
+//
+//  The same shape (and seed) always generates the same source, and it
+//  always compiles without errors.
+//
+
+
+struct CorpusShape
+{
+    size_t size = 1 << 20;            // in bytes, the source ends with the first function past it
+    uint32_t nesting_depth = 3;       // of the blocks inside the functions
+    uint32_t expression_density = 50; // 0-100, how many operands expressions have
+    uint32_t comment_ratio = 10;      // 0-100, percentage of the lines that are comments
+    uint32_t seed = 1;
+    std::string prefix;               // of the names of the functions and variables (to give each file of a batch its own)
+};
+
+
+std::string generate_corpus(const CorpusShape& shape);
+
+
+#endif
@@ -0,0 +1,46 @@
+
+// built-in
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// extern
+#include "lib/CLI11.hpp"
+
+// local
+#include "corpus.hpp"
+#include "utils.hpp"
+
+
+
+//  Writes a synthetic corpus to a file, to measure the whole compiler
+//  on it (eg, 'jts2gd --stats corpus.js').
+int main(int argc, char** argv)
+{
+    std::string output_file;
+    uint32_t size_mb = 1;
+    CorpusShape shape;
+
+    CLI::App program {"JTS2GD corpus generator"};
+    program.add_option("-o, --output", output_file, "file to write the corpus to")->required();
+    program.add_option("--size-mb", size_mb, "size of the corpus in MB (default: 1)");
+    program.add_option("--depth", shape.nesting_depth, "nesting depth of the blocks (default: 3)");
+    program.add_option("--density", shape.expression_density, "expression density, 0-100 (default: 50)");
+    program.add_option("--comments", shape.comment_ratio, "percentage of the lines that are comments (default: 10)");
+    program.add_option("--seed", shape.seed, "seed of the generator (default: 1)");
+
+    CLI11_PARSE(program, argc, argv);
+
+    shape.size = (size_t)size_mb << 20;
+    const std::string corpus = generate_corpus(shape);
+
+    std::ofstream file {output_file, std::ios::binary};
+    file.write(corpus.data(), corpus.size());
+    file.close();
+
+    if (file.fail())
+        panic("could not write '" + output_file + "'");
+
+    return 0;
+}
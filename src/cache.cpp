@@ -0,0 +1,203 @@
+
+// built-in
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <sstream>
+#include <system_error>
+#include <thread>
+
+// local
+#include "cache.hpp"
+#include "utils.hpp"
+
+
+#ifndef JTS2GD_VERSION
+    #define JTS2GD_VERSION "unknown"
+#endif
+
+
+namespace fs = std::filesystem;
+
+
+
+//  128-bit non-cryptographic hash (two lanes of xxhash64-like rounds
+//  with different seeds), fast enough to not be noticed next to the
+//  time spent reading the file.
+class ContentHasher
+{
+    private:
+
+        static constexpr uint64_t prime1 = 0x9E3779B185EBCA87ull;
+        static constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+
+        uint64_t lanes[2] = {0x243F6A8885A308D3ull, 0x13198A2E03707344ull};
+        uint64_t length = 0;
+
+        static uint64_t rotate(uint64_t value, int bits)
+        {
+            return (value << bits) | (value >> (64 - bits));
+        }
+
+        void round(uint64_t word)
+        {
+            for (auto& lane: this->lanes)
+                lane = rotate(lane + word * prime2, 31) * prime1;
+        }
+
+        static uint64_t avalanche(uint64_t value)
+        {
+            value ^= value >> 33;
+            value *= 0xFF51AFD7ED558CCDull;
+            value ^= value >> 33;
+            value *= 0xC4CEB9FE1A85EC53ull;
+            value ^= value >> 33;
+            return value;
+        }
+
+    public:
+
+        void update(std::string_view data)
+        {
+            const char* ptr = data.data();
+            const char* end = ptr + data.size();
+
+            for (; end - ptr >= 8; ptr += 8)
+            {
+                uint64_t word;
+                std::memcpy(&word, ptr, 8);
+                this->round(word);
+            }
+
+            uint64_t tail = 0;
+            std::memcpy(&tail, ptr, end - ptr);
+            this->round(tail ^ ((uint64_t)(end - ptr) << 56));
+
+            this->length += data.size();
+        }
+
+        std::string hex_digest() const
+        {
+            static constexpr char digits[] = "0123456789abcdef";
+            std::string out;
+
+            for (auto lane: this->lanes)
+            {
+                uint64_t value = avalanche(lane ^ this->length);
+                for (int shift = 60; shift >= 0; shift -= 4)
+                    out.push_back(digits[(value >> shift) & 0xF]);
+            }
+
+            return out;
+        }
+};
+
+
+
+BuildCache::BuildCache(const std::string& directory, const std::string& salt)
+: directory(directory), salt(salt)
+{
+    std::error_code error;
+    fs::create_directories(this->directory, error);
+
+    if (error)
+        panic("could not create the cache directory '" + this->directory + "'");
+}
+
+
+std::string BuildCache::key(const std::string& input_path, std::string_view content) const
+{
+    ContentHasher hasher;
+
+    // every part ends with a round of its own, so bytes can not move between them unnoticed
+    hasher.update(JTS2GD_VERSION);
+    hasher.update(this->salt);
+    hasher.update(input_path);
+    hasher.update(content);
+
+    return hasher.hex_digest();
+}
+
+
+bool BuildCache::restore(const std::string& key, const std::string& output_path, std::ostream& log) const
+{
+    const std::string output_entry = this->entry_path(key, ".gd");
+    std::ifstream log_entry {this->entry_path(key, ".log"), std::ios::binary};
+
+    std::error_code error;
+    if (!log_entry || !fs::exists(output_entry, error))
+        return false;
+
+    // nothing to do if the output is already a link to the entry
+    if (!fs::equivalent(output_entry, output_path, error))
+    {
+        fs::remove(output_path, error);
+        fs::create_hard_link(output_entry, output_path, error);
+
+        if (error && !fs::copy_file(output_entry, output_path, fs::copy_options::overwrite_existing, error))
+            return false;
+    }
+
+    // (inserting an empty 'rdbuf' would set the failbit of 'log')
+    log << std::string{std::istreambuf_iterator<char>{log_entry}, {}} << std::flush;
+    return true;
+}
+
+
+void BuildCache::store(const std::string& key, const std::string& output_path, const std::string& diagnostics) const
+{
+    std::error_code error;
+
+    // the log is published first: an entry exists only once its output does
+    const std::string log_temp = this->temporary_path(key, ".log");
+    {
+        std::ofstream log_file {log_temp, std::ios::binary};
+        log_file << diagnostics;
+
+        if (!log_file)
+        {
+            fs::remove(log_temp, error);
+            return;
+        }
+    }
+    fs::rename(log_temp, this->entry_path(key, ".log"), error);
+
+    if (error)
+    {
+        fs::remove(log_temp, error);
+        return;
+    }
+
+    const std::string output_temp = this->temporary_path(key, ".gd");
+    fs::create_hard_link(output_path, output_temp, error);
+
+    if (error)
+        fs::copy_file(output_path, output_temp, fs::copy_options::overwrite_existing, error);
+
+    if (!error)
+        fs::rename(output_temp, this->entry_path(key, ".gd"), error);
+
+    if (error)
+        fs::remove(output_temp, error);
+}
+
+
+std::string BuildCache::entry_path(const std::string& key, const char* extension) const
+{
+    return (fs::path(this->directory) / (key + extension)).string();
+}
+
+// unique name in the cache directory for an entry being written
+std::string BuildCache::temporary_path(const std::string& key, const char* extension) const
+{
+    std::ostringstream name;
+    name << key << extension << '.'
+         << std::hash<std::thread::id>{}(std::this_thread::get_id()) << '.'
+         << std::chrono::steady_clock::now().time_since_epoch().count()
+         << ".tmp";
+
+    return (fs::path(this->directory) / name.str()).string();
+}
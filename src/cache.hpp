@@ -0,0 +1,61 @@
+#ifndef JTS2GD_CACHE
+#define JTS2GD_CACHE
+
+
+// built-in
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+
+//
+//  BuildCache
+//
+//
+//  Persistent cache of compiled files, so a rebuild of a project
+//  only compiles the files that changed since the last one.
+//
+//  An entry is keyed by a hash of the compiler version, the options
+//  that change the outputs or the diagnostics (the 'salt'), the input
+//  path (it appears in the diagnostics) and the content of the file.
+//  It stores the generated GDScript ('<key>.gd') and the diagnostics
+//  printed by the compilation ('<key>.log'); only files compiled
+//  without errors are stored.
+//
+//  Outputs are hard links to the entries when possible (copies
+//  otherwise), so the compiler always removes an output before
+//  writing it, never writing through the link into the cache.
+//
+//  Entries are published with a rename, so concurrent compilations
+//  (threads or processes) sharing the directory never see partial ones.
+//
+
+
+class BuildCache
+{
+    private:
+
+        std::string directory;
+        std::string salt;
+
+    public:
+
+        BuildCache(const std::string& directory, const std::string& salt);
+
+        std::string key(const std::string& input_path, std::string_view content) const;
+
+        // puts the cached output in 'output_path' and replays its diagnostics on 'log', false if not cached
+        bool restore(const std::string& key, const std::string& output_path, std::ostream& log) const;
+
+        // stores a compiled output and the diagnostics of its compilation
+        void store(const std::string& key, const std::string& output_path, const std::string& diagnostics) const;
+
+    private:
+
+        std::string entry_path(const std::string& key, const char* extension) const;
+        std::string temporary_path(const std::string& key, const char* extension) const;
+};
+
+
+#endif
@@ -1,6 +1,5 @@
 
 // built-in
-#include <typeinfo>
 #include <cstdint>
 
 // local
@@ -12,12 +11,12 @@
 
 void GDScriptCGen::visit(VarDecl& vdecl)
 {
-    this->output.append(vdecl.var->lexeme);
+    this->output.append(vdecl.var->lexeme());
 
     if (vdecl.type != nullptr)
     {
         this->output.append(": ");
-        this->output.append(this->translate_type(vdecl.type->lexeme));
+        this->output.append(this->translate_type(*vdecl.type));
     }
 
     if (vdecl.init_value != nullptr)
@@ -78,17 +77,16 @@ void GDScriptCGen::visit(MemberAccessPart& mexpr)
 
     if (this->func_id)
     {
-        this->output.append(this->translate_function(mexpr.member->lexeme));
+        this->output.append(this->translate_function(*mexpr.member));
     
-        if (mexpr.member->lexeme == "log")
+        if (mexpr.member->lexeme() == "log")
         {   
-            auto idx = this->output.find("console.log", this->output.size() - 11);
-            if (idx != this->output.npos)
-                this->output.replace(idx, 11, "print");
+            if (this->output.ends_with("console.log"))
+                this->output.replace_tail(11, "print");
         }
     }
     else
-       this->output.append(mexpr.member->lexeme);
+       this->output.append(mexpr.member->lexeme());
 }
 
 void GDScriptCGen::visit(ConditionalExpr& cexpr)
@@ -102,7 +100,7 @@ void GDScriptCGen::visit(ConditionalExpr& cexpr)
 
 void GDScriptCGen::visit(BinaryExpr& bexpr)
 {
-    auto oprt_lexeme = bexpr.oprt->lexeme;
+    auto oprt_lexeme = bexpr.oprt->lexeme();
 
     if (bexpr.oprt->type == TokenType::INSTANCEOF)
         oprt_lexeme = "is";
@@ -117,7 +115,7 @@ void GDScriptCGen::visit(BinaryExpr& bexpr)
 
 void GDScriptCGen::visit(UnaryExpr& uexpr)
 {
-    this->output.append(uexpr.oprt->lexeme);
+    this->output.append(uexpr.oprt->lexeme());
     this->visit(uexpr.value);
 }
 
@@ -130,10 +128,10 @@ void GDScriptCGen::render_primary_expression(PrimaryExpr& pexpr, bool render_ini
         {
             case (PrimaryExprType::IDENTIFIER):
             {
-                if (!pexpr.parts.empty() && typeid(*pexpr.parts.at(0)) == typeid(FunctionCallPart))
-                    this->output.append(this->translate_function(pexpr.identifier->lexeme));
+                if (render_end > 0 && pexpr.parts[0]->kind == NodeKind::FUNCTION_CALL_PART)
+                    this->output.append(this->translate_function(*pexpr.identifier));
                 else
-                    this->output.append(pexpr.identifier->lexeme);
+                    this->output.append(pexpr.identifier->lexeme());
 
                 break;
             }
@@ -149,7 +147,7 @@ void GDScriptCGen::render_primary_expression(PrimaryExpr& pexpr, bool render_ini
 
             case (PrimaryExprType::LITERAL):
             {
-                this->output.append(pexpr.literal->lexeme);
+                this->output.append(pexpr.literal->lexeme());
                 
                 break;
             }
@@ -183,69 +181,55 @@ void GDScriptCGen::render_primary_expression(PrimaryExpr& pexpr, bool render_ini
     for (uint32_t idx = render_start; idx < size; ++idx)
     {
         this->func_id = false;
-        if (idx + 1 < size && typeid(*pexpr.parts.at(idx + 1)) == typeid(FunctionCallPart))
+        if (idx + 1 < size && pexpr.parts[idx + 1]->kind == NodeKind::FUNCTION_CALL_PART)
             this->func_id = true;
 
-        this->visit(pexpr.parts.at(idx));
+        this->visit(pexpr.parts[idx]);
     }
 }
 
 
 void GDScriptCGen::visit(PrimaryExpr& pexpr)
 {
+    this->render_call_chain(pexpr, pexpr.parts.size());
+}
 
-    auto render_args = [this](const std::vector<Expression*>& args) -> void
+//  Renders 'pexpr' as if it had only its first 'end' parts, without
+//  modifying the tree. A call of something that is not a plain function
+//  name (a variable, an element, a call result) becomes 'call(callee, args)',
+//  with the callee rendered recursively from the parts before the call.
+void GDScriptCGen::render_call_chain(PrimaryExpr& pexpr, uint32_t end)
+{
+    auto is_callable_value = [&pexpr, this](int64_t idx) -> bool
     {
-        uint32_t size = args.size();
+        if (idx == -1)
+            return pexpr.type != PrimaryExprType::IDENTIFIER || this->scope.has_var(pexpr.identifier->symbol);
 
-        if (size == 0)
-            return;
-
-        this->visit(args[0]);
-        for (uint32_t idx = 1; idx < size; ++idx)
-        {
-            this->output.append(", ");
-            this->visit(args[idx]);
-        }
+        return pexpr.parts[idx]->kind != NodeKind::MEMBER_ACCESS_PART;
     };
 
-    auto fold_fexpr_call = [&pexpr, &render_args, this](uint32_t end, const std::vector<Expression*>& args) -> void
+    for (int64_t idx = (int64_t)end - 1; idx >= 0; --idx)
     {
-        this->output.append("call(");
-        std::vector<MemberExprPart*> tmp {pexpr.parts.begin() + end, pexpr.parts.end()};
-        pexpr.parts.resize(end);
-        this->visit(pexpr);
-        pexpr.parts.insert(pexpr.parts.end(), tmp.begin(), tmp.end());
-
-        if (!args.empty())
+        if (pexpr.parts[idx]->kind == NodeKind::FUNCTION_CALL_PART && is_callable_value(idx - 1))
         {
-            this->output.append(", ");
-            render_args(args);
-        }
-        this->output.push_back(')');
-    };
+            const auto& args = static_cast<FunctionCallPart*>(pexpr.parts[idx])->args;
 
-    auto check_part = [&pexpr, this](int64_t idx) -> bool
-    {
-        if (idx == -1 && (pexpr.type != PrimaryExprType::IDENTIFIER || this->scope.has_var(pexpr.identifier->lexeme)))
-            return true;
-        else
-            if (idx != -1 && typeid(*pexpr.parts.at(idx)) != typeid(MemberAccessPart))
-                return true;
-        
-        return false;
-    };
+            this->output.append("call(");
+            this->render_call_chain(pexpr, (uint32_t)idx);
 
-    int64_t end = -1;
-    if (pexpr.parts.size() > 0)
-        for (int64_t idx = pexpr.parts.size() - 1; idx >= 0; --idx)
-            if (typeid(*pexpr.parts.at((size_t)idx)) == typeid(FunctionCallPart) && check_part(idx - 1))
+            for (auto arg: args)
             {
-                fold_fexpr_call((uint32_t)idx, static_cast<FunctionCallPart*>(pexpr.parts.at((size_t)idx))->args);
-                end = idx;
-                break;
+                this->output.append(", ");
+                this->visit(arg);
             }
-    this->render_primary_expression(pexpr, end == -1, end + 1, pexpr.parts.size());
+            this->output.push_back(')');
+
+            this->render_primary_expression(pexpr, false, idx + 1, end);
+            return;
+        }
+    }
+
+    this->render_primary_expression(pexpr, true, 0, end);
 }
 
 void GDScriptCGen::visit(Block& blk)
@@ -272,7 +256,7 @@ void GDScriptCGen::visit(VarDeclStmt& vdecl)
         this->indent();
         this->output.append(VarDeclStmtTypeRepr[(int)vdecl.type]);
         this->output.push_back(' ');
-        this->scope.push_var_definition(decl->var->lexeme);
+        this->scope.push_var_definition(decl->var->symbol);
         this->visit(decl);
         this->line_feed();
     }
@@ -333,8 +317,8 @@ void GDScriptCGen::visit(ForStmt& fstmt)
     if (fstmt.for_of)
     {
         this->output.append("for ");
-        this->output.append(fstmt.init_var_decl->lexeme);
-        this->scope.push_var_definition(fstmt.init_var_decl->lexeme);
+        this->output.append(fstmt.init_var_decl->lexeme());
+        this->scope.push_var_definition(fstmt.init_var_decl->symbol);
         this->output.append(" in ");
         this->visit(fstmt.of_expr);
         this->output.push_back(':');
@@ -450,7 +434,7 @@ void GDScriptCGen::visit(FunctionStmt& fdecl)
 {
     this->indent();
     this->output.append("func ");
-    this->output.append(fdecl.name->lexeme);
+    this->output.append(fdecl.name->lexeme());
     this->output.push_back('(');
 
     if (!fdecl.params.empty())
@@ -469,7 +453,7 @@ void GDScriptCGen::visit(FunctionStmt& fdecl)
     if (fdecl.type != nullptr)
     {
         this->output.append(" -> ");
-        this->output.append(this->translate_type(fdecl.type->lexeme));
+        this->output.append(this->translate_type(*fdecl.type));
     }
 
     this->output.push_back(':');
@@ -487,7 +471,7 @@ void GDScriptCGen::visit(FunctionStmt& fdecl)
     {   this->scope.push_level();
 
         for (auto arg: fdecl.params)
-            this->scope.push_var_definition(arg->var->lexeme);
+            this->scope.push_var_definition(arg->var->symbol);
 
         for (auto stmt: fdecl.func_body)
         {
@@ -515,14 +499,14 @@ void GDScriptCGen::visit(ExtendsStmt& estmt)
 {
     this->indent();
     this->output.append("extends ");
-    this->output.append(estmt.name->lexeme);
+    this->output.append(estmt.name->lexeme());
 }
 
 void GDScriptCGen::visit(ClassExtendsStmt& cestmt)
 {
     this->indent();
     this->output.append("extends ");
-    this->output.append(cestmt.extended->lexeme);
+    this->output.append(cestmt.extended->lexeme());
     
     this->line_feed();
 
@@ -551,7 +535,7 @@ void GDScriptCGen::visit(FunctionExpression& fexpr)
 {
     this->indent();
     this->output.append("func ");
-    this->output.append(fexpr.name.lexeme);
+    this->output.append(fexpr.name.lexeme());
     this->output.push_back('(');
 
     if (!fexpr.params.empty())
@@ -591,7 +575,7 @@ void GDScriptCGen::visit(FunctionExpression& fexpr)
             this->scope.push_level();
 
             for (auto arg: fexpr.params)
-                this->scope.push_var_definition(arg->var->lexeme);
+                this->scope.push_var_definition(arg->var->symbol);
 
             for (auto stmt: fexpr.func_body)
             {
@@ -609,20 +593,43 @@ void GDScriptCGen::visit(FunctionExpression& fexpr)
 
 
 
-std::string_view GDScriptCGen::translate_function(const std::string_view& name)
+//  A translation table by symbol. The tables never change, so each is
+//  interned once per process and shared by every file and thread.
+using SymbolTranslations = std::unordered_map<Symbol, std::string_view>;
+
+static SymbolTranslations by_symbol(const std::unordered_map<std::string_view, std::string_view>& table)
 {
-    auto ptr = function_table.find(name);
-    if (ptr != function_table.end())
-        return ptr->second;
-    else
-        return name;
+    SymbolTranslations translations;
+
+    for (auto& [name, translation]: table)
+        translations.emplace(SymbolTable::intern(name), translation);
+
+    return translations;
 }
 
-std::string_view GDScriptCGen::translate_type(const std::string_view& type_name)
+
+//  Translates the name of 'tk' with 'table', by its symbol if it has one
+//  (names that are not in the table are kept).
+static std::string_view translate(const Token& tk, const std::unordered_map<std::string_view, std::string_view>& table, const SymbolTranslations& translations)
 {
-    auto ptr = type_table.find(type_name);
-    if (ptr != type_table.end())
-        return ptr->second;
-    else
-        return type_name;
+    if (tk.symbol == SymbolTable::none)
+    {
+        auto ptr = table.find(tk.lexeme());
+        return ptr != table.end() ? ptr->second : tk.lexeme();
+    }
+
+    auto ptr = translations.find(tk.symbol);
+    return ptr != translations.end() ? ptr->second : tk.lexeme();
+}
+
+std::string_view GDScriptCGen::translate_function(const Token& name)
+{
+    static const SymbolTranslations functions = by_symbol(function_table);
+    return translate(name, function_table, functions);
+}
+
+std::string_view GDScriptCGen::translate_type(const Token& type_name)
+{
+    static const SymbolTranslations types = by_symbol(type_table);
+    return translate(type_name, type_table, types);
 }
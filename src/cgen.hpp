@@ -6,47 +6,98 @@
 #include <string_view>
 #include <type_traits>
 #include <unordered_map>
-#include <unordered_set>
+#include <algorithm>
 #include <cstdint>
+#include <utility>
+#include <vector>
 
 // local
 #include "tree.hpp"
+#include "code_buffer.hpp"
+#include "stats.hpp"
 
 
 
 
 
+//
+//  Scope
+//
+//
+//  Variables defined in the scopes being generated, as a flat table
+//  indexed by symbol: 'depth[symbol]' is the level of its innermost
+//  definition (0 if it is not defined), so a lookup is a single access.
+//
+//  Defining a variable saves the depth it replaces in an undo log,
+//  and popping a level restores the entries logged since it was pushed.
+//
+//  The table covers every symbol of the process, not only those of one
+//  file, so it is not rebuilt for each file: every thread keeps one
+//  scope ('of_thread') for all the files it generates, and 'clear' only
+//  restores the entries in the undo log.
+//
+
+
 class Scope
 {
-    std::vector<std::unordered_set<std::string_view>> scope_hierarchy;
+    std::vector<uint32_t> depth;
+    std::vector<std::pair<Symbol, uint32_t>> undo_log;  // (symbol, previous depth)
+    std::vector<size_t> level_starts;                   // size of the undo log when each level was pushed
 
     public:
+
+        // the scope of the calling thread, emptied for a new file
+        static Scope& of_thread()
+        {
+            thread_local Scope scope;
+
+            scope.clear();
+            return scope;
+        }
+
+        void clear()
+        {
+            while (!this->level_starts.empty())
+                this->pop_level();
+        }
     
         void pop_level()
         {
-            if (scope_hierarchy.size() == 0)
+            if (this->level_starts.size() == 0)
                 panic("compiler internal error");
 
-            this->scope_hierarchy.pop_back();
+            for (size_t idx = this->undo_log.size(); idx > this->level_starts.back(); --idx)
+                this->depth[this->undo_log[idx - 1].first] = this->undo_log[idx - 1].second;
+
+            this->undo_log.resize(this->level_starts.back());
+            this->level_starts.pop_back();
         }
 
         void push_level()
         {
-            this->scope_hierarchy.push_back({});
+            this->level_starts.push_back(this->undo_log.size());
         }
 
-        void push_var_definition(std::string_view new_var)
+        void push_var_definition(Symbol new_var)
         {
-            this->scope_hierarchy.back().insert(new_var);
+            if (new_var == SymbolTable::none)
+                return;
+
+            const uint32_t level = this->level_starts.size();
+
+            if (new_var >= this->depth.size())
+                this->depth.resize(std::max<size_t>(new_var + 1, SymbolTable::count()), 0);
+
+            if (this->depth[new_var] == level)
+                return;
+
+            this->undo_log.emplace_back(new_var, this->depth[new_var]);
+            this->depth[new_var] = level;
         }
 
-        bool has_var(std::string_view var)
+        bool has_var(Symbol var) const
         {
-            for (auto it = this->scope_hierarchy.rbegin(); it != this->scope_hierarchy.rend(); ++it)
-                if (it->find(var) != it->end())
-                    return true;
-
-            return false;
+            return var < this->depth.size() && this->depth[var] != 0;
         }
 };
 
@@ -91,14 +142,20 @@ class GDScriptCGen: public Visitor
 
         uint32_t indentation = 0;
         bool func_id = false;
-        Scope scope;
+        Scope& scope;
 
     public:
 
-        std::string output;
+        CodeBuffer& output;
 
     public:
 
+        explicit GDScriptCGen(CodeBuffer& output)
+        : scope(Scope::of_thread()), output(output)
+        {
+
+        }
+
         template <typename T, typename = std::enable_if_t<std::is_base_of_v<Element, T>>>
         void visit(T* element)
         {
@@ -111,7 +168,7 @@ class GDScriptCGen: public Visitor
         void indent(int offset = 0)
         {
             if (int64_t(this->indentation) + offset >= 0)
-                this->output.append(std::string(4 * (this->indentation + offset), ' '));
+                this->output.indent(this->indentation + offset);
         }
 
         void line_feed()
@@ -147,18 +204,20 @@ class GDScriptCGen: public Visitor
 
 
         void render_primary_expression(PrimaryExpr& pexpr, bool render_init, uint32_t render_start, uint32_t render_end);
-        std::string_view translate_function(const std::string_view&);
-        std::string_view translate_type(const std::string_view&);
+        void render_call_chain(PrimaryExpr& pexpr, uint32_t end);
+        std::string_view translate_function(const Token&);
+        std::string_view translate_type(const Token&);
 
 };
 
 
-inline std::string gen_gdscript(Program* prog)
+// generates the code of 'prog' into 'output' (streamed if it is open on a file)
+inline void gen_gdscript(Program* prog, CodeBuffer& output)
 {
-    GDScriptCGen generator;
-    generator.visit(prog);
+    JTS2GD_STATS_PHASE(CODEGEN);
 
-    return generator.output;
+    GDScriptCGen generator {output};
+    generator.visit(prog);
 }
 
 #endif
@@ -0,0 +1,129 @@
+
+// built-in
+#include <cerrno>
+#include <cstdint>
+
+#ifdef _WIN32
+    #include <io.h>
+    #include <fcntl.h>
+    #include <sys/stat.h>
+#else
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+// local
+#include "code_buffer.hpp"
+#include "stats.hpp"
+
+
+
+#ifdef _WIN32
+
+static int create_file(const char* path)
+{
+    return _open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+}
+
+static int64_t write_bytes(int fd, const char* buffer, size_t size)
+{
+    return _write(fd, buffer, (unsigned int)size);
+}
+
+static int close_file(int fd)
+{
+    return _close(fd);
+}
+
+#else
+
+static int create_file(const char* path)
+{
+    return open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+}
+
+static int64_t write_bytes(int fd, const char* buffer, size_t size)
+{
+    return write(fd, buffer, size);
+}
+
+static int close_file(int fd)
+{
+    return close(fd);
+}
+
+#endif
+
+
+
+CodeBuffer::CodeBuffer(size_t size_hint)
+{
+    // the buffer never holds much more than a chunk once streaming
+    size_t capacity = size_hint + size_hint / 4 + 64;
+    this->text.reserve(capacity < flush_size + 4096 ? capacity : flush_size + 4096);
+}
+
+CodeBuffer::~CodeBuffer()
+{
+    if (this->fd >= 0)
+        close_file(this->fd);
+}
+
+
+bool CodeBuffer::open(const std::string& path)
+{
+    JTS2GD_STATS_PHASE(WRITE);
+
+    this->fd = create_file(path.c_str());
+    this->failed = this->fd < 0;
+
+    return !this->failed;
+}
+
+
+bool CodeBuffer::close()
+{
+    if (this->fd < 0)
+        return false;
+
+    JTS2GD_STATS_PHASE(WRITE);
+    this->flush(0);
+
+    if (close_file(this->fd) != 0)
+        this->failed = true;
+
+    this->fd = -1;
+    return !this->failed;
+}
+
+
+void CodeBuffer::flush(size_t keep)
+{
+    if (this->text.size() <= keep)
+        return;
+
+    JTS2GD_STATS_PHASE(WRITE);
+    JTS2GD_STATS_COUNT(EMITTED_BYTES, this->text.size() - keep);
+
+    const size_t size = this->text.size() - keep;
+    const char* ptr = this->text.data();
+    const char* end = ptr + size;
+
+    // a single call, unless the system takes only part of the chunk
+    while (ptr < end && !this->failed)
+    {
+        int64_t written = write_bytes(this->fd, ptr, end - ptr);
+
+        if (written < 0 && errno == EINTR)
+            continue;
+
+        if (written <= 0)
+            this->failed = true;
+        else
+            ptr += written;
+    }
+
+    // after a failure the text is dropped anyway, 'close' reports it
+    this->text.erase(0, size);
+}
@@ -0,0 +1,126 @@
+#ifndef JTS2GD_CODE_BUFFER
+#define JTS2GD_CODE_BUFFER
+
+
+// built-in
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+
+//
+//  CodeBuffer
+//
+//
+//  Output of the code generator. Once 'open'ed on a file, the text is
+//  streamed to it: whenever 'flush_size' bytes are buffered they are
+//  written, so the memory used does not depend on the size of the
+//  generated code. Small outputs are written with a single call, by
+//  'close'.
+//
+//  The generator sometimes edits what it has just written (removing
+//  the last line feed, rewriting "console.log" to "print"), so the
+//  last 'window' bytes are always kept in the buffer. Edits must not
+//  reach further back than that.
+//
+//  Without a file, the whole text stays in memory (see 'view').
+//
+//  Indentation is copied from a static slab of spaces, so it never
+//  builds a temporary string.
+//
+
+
+class CodeBuffer
+{
+    public:
+
+        static constexpr size_t flush_size = 64 * 1024;
+        static constexpr size_t window = 16;
+
+    private:
+
+        static constexpr std::string_view spaces {"                                                                "};
+        static constexpr uint32_t indent_width = 4;
+
+        std::string text;
+        int fd = -1;
+        bool failed = false;
+
+    public:
+
+        // 'size_hint' is the size of the source (the generated code is about as large)
+        explicit CodeBuffer(size_t size_hint);
+        ~CodeBuffer();
+
+        CodeBuffer(const CodeBuffer&) = delete;
+        CodeBuffer& operator=(const CodeBuffer&) = delete;
+
+        // (over)writes the file at 'path' with the text appended from now on, false on failure
+        bool open(const std::string& path);
+
+        // writes what is left and closes the file, false if any write failed
+        bool close();
+
+        void append(std::string_view chars)
+        {
+            this->text.append(chars);
+            this->flush_if_full();
+        }
+
+        void push_back(char ch)
+        {
+            this->text.push_back(ch);
+            this->flush_if_full();
+        }
+
+        void pop_back()
+        {
+            this->text.pop_back();
+        }
+
+        // appends the indentation of 'levels' levels
+        void indent(uint32_t levels)
+        {
+            for (size_t size = levels * indent_width; size > 0; )
+            {
+                size_t chunk = size < spaces.size() ? size : spaces.size();
+                this->text.append(spaces.data(), chunk);
+                size -= chunk;
+            }
+            this->flush_if_full();
+        }
+
+        // 'suffix' must fit in the window
+        bool ends_with(std::string_view suffix) const
+        {
+            return this->text.size() >= suffix.size()
+                && std::string_view{this->text}.substr(this->text.size() - suffix.size()) == suffix;
+        }
+
+        // replaces the last 'count' chars ('count' must fit in the window)
+        void replace_tail(size_t count, std::string_view chars)
+        {
+            this->text.replace(this->text.size() - count, count, chars);
+        }
+
+        // text not written yet (all of it without a file)
+        std::string_view view() const
+        {
+            return this->text;
+        }
+
+    private:
+
+        void flush_if_full()
+        {
+            if (this->fd >= 0 && this->text.size() >= flush_size)
+                this->flush(window);
+        }
+
+        // writes all but the last 'keep' bytes
+        void flush(size_t keep);
+};
+
+
+#endif
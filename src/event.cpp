@@ -0,0 +1,341 @@
+
+// built-in
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <iterator>
+#include <memory>
+
+// local
+#include "event.hpp"
+
+
+
+//  Name (the rule of the JSON formats) and text of every message.
+//  '{}' is replaced by the next argument of the event.
+struct Message
+{
+    std::string_view name;
+    std::string_view text;
+};
+
+static constexpr Message messages[]
+{
+    {"invalid-char",                      "invalid char"},
+    {"unexpected-token",                  "unexpected token '{}'"},
+    {"unexpected-token",                  "unexpected token '{}' {}"},
+    {"for-of-without-declaration",        "'for of' loops must contain a variable declaration, unexpected token '{}' {}"},
+    {"for-of-multiple-variables",         "GDscript only allows a single variable to be declared in a for of loop"},
+    {"for-of-typed-variable",             "GDscript does not support static typing on variables declared in for of loops"},
+    {"for-of-initialized-variable",       "GDscript does not support initialization of variables in for of loops"},
+    {"for-constancy",                     "constancy cannot be ensured in for loops"},
+    {"labels",                            "GDscript does not support labels"},
+    {"import-statement",                  "GDscript does not support import statement"},
+    {"with-statement",                    "GDscript does not support with statement"},
+    {"invalid-case-expression",           "invalid case expression, only member access (\"A.B\") is allowed in GDScript"},
+    {"exceptions",                        "GDscript does not support exceptions"},
+    {"comma-operator",                    "comma operator does not exist in GDscript"},
+    {"assignment-value",                  "assignment returns nothing in GDScript"},
+    {"zero-fill-right-shift-assignment",  "Operator zero fill right shift equal(>>>=) does not exist in GDScript"},
+    {"zero-fill-right-shift",             "Operator zero fill right shift(>>>) does not exist in GDScript"},
+    {"unsupported-operator",              "it is not possible to translate the '{}' operator to gdscript"},
+    {"postfix-operators",                 "gdscript doesn't have posfix operators"},
+    {"elision",                           "elision of items in literal lists does not exist in GDscript"},
+    {"function-expressions",              "function expressions does not exist in GDscript"},
+    {"compilation-failed",                "{}"},
+};
+
+static_assert(std::size(messages) == (size_t)MessageId::COUNT, "every message needs a text");
+
+
+// the codes 'get_color' builds, made once
+#ifndef _WIN32
+    static constexpr std::string_view type_colors[] {"\033[33m", "\033[91m"}; // FG_YELLOW, FG_LIGHT_RED
+    static constexpr std::string_view default_color {"\033[39m"};
+    static constexpr std::string_view message_color {"\033[97m"};              // FG_WHITE
+#else
+    static constexpr std::string_view type_colors[] {"", ""};
+    static constexpr std::string_view default_color {""};
+    static constexpr std::string_view message_color {""};
+#endif
+
+static constexpr std::string_view type_names[] {"WARNING", "ERROR"};
+
+
+
+static void append_number(std::string& out, uint32_t number)
+{
+    char digits[10];
+    auto result = std::to_chars(digits, digits + sizeof(digits), number);
+    out.append(digits, result.ptr);
+}
+
+
+// appends a path as a relative URI reference (for SARIF), escaped for JSON
+static void append_uri(std::string& out, std::string_view path)
+{
+    static constexpr char hex[] = "0123456789ABCDEF";
+
+    for (const char ch: path)
+    {
+        const uint8_t byte = ch;
+
+        if (ch == '\\')
+            out.push_back('/');
+        else if (std::isalnum(byte) || std::strchr("-._~/:@!$&'()*+,;=", ch) != nullptr)
+            out.push_back(ch);
+        else
+        {
+            out.push_back('%');
+            out.push_back(hex[byte >> 4]);
+            out.push_back(hex[byte & 0xF]);
+        }
+    }
+}
+
+
+template <class APPEND>
+void Event::write_message(APPEND append) const
+{
+    std::string_view text = messages[(size_t)this->message].text;
+    uint32_t argument = 0;
+
+    for (size_t slot = text.find("{}"); slot != std::string_view::npos; slot = text.find("{}"))
+    {
+        append(text.substr(0, slot));
+        if (argument < max_arguments)
+            append(this->arguments[argument++]);
+        text.remove_prefix(slot + 2);
+    }
+
+    append(text);
+}
+
+
+void Event::format(std::string& out, DiagnosticsFormat format) const
+{
+    switch (format)
+    {
+        case DiagnosticsFormat::TEXT:  this->format_text(out); break;
+        case DiagnosticsFormat::JSONL: this->format_json(out); break;
+        case DiagnosticsFormat::SARIF: this->format_sarif(out); break;
+    }
+}
+
+
+void Event::format_text(std::string& out) const
+{
+    const int type_idx = (int)this->type;
+
+    out.push_back('[');
+    out.append(type_colors[type_idx]);
+    out.append(type_names[type_idx]);
+    out.append(default_color);
+    out.append("](");
+
+    out.append(*this->location.file_name);
+    if (this->location.line > 0)
+    {
+        out.push_back(':');
+        append_number(out, this->location.line);
+        out.push_back(':');
+        append_number(out, this->location.collum);
+    }
+    out.append("): ");
+
+    out.append(message_color);
+    this->write_message([&out](std::string_view piece) { out.append(piece); });
+    out.append(default_color);
+    out.push_back('\n');
+}
+
+
+//  {"severity":"error","rule":"labels","message":"...","file":"a.js",
+//   "line":1,"column":1,"offset":0,"length":4}
+//
+//  (without "line" and the fields after it for the whole file)
+void Event::format_json(std::string& out) const
+{
+    out.append("{\"severity\":\"");
+    out.append(this->type == EventType::ERROR ? "error" : "warning");
+    out.append("\",\"rule\":\"");
+    out.append(messages[(size_t)this->message].name);
+    out.append("\",\"message\":\"");
+    this->write_message([&out](std::string_view piece) { append_json(out, piece); });
+    out.append("\",\"file\":\"");
+    append_json(out, *this->location.file_name);
+
+    if (this->location.line == 0)
+    {
+        out.append("\"}\n");
+        return;
+    }
+
+    out.append("\",\"line\":");
+    append_number(out, this->location.line);
+    out.append(",\"column\":");
+    append_number(out, this->location.collum);
+    out.append(",\"offset\":");
+    append_number(out, this->location.offset);
+    out.append(",\"length\":");
+    append_number(out, this->location.size);
+    out.append("}\n");
+}
+
+
+// a 'result' object of SARIF 2.1.0
+void Event::format_sarif(std::string& out) const
+{
+    out.append("{\"ruleId\":\"");
+    out.append(messages[(size_t)this->message].name);
+    out.append("\",\"level\":\"");
+    out.append(this->type == EventType::ERROR ? "error" : "warning");
+    out.append("\",\"message\":{\"text\":\"");
+    this->write_message([&out](std::string_view piece) { append_json(out, piece); });
+    out.append("\"},\"locations\":[{\"physicalLocation\":{\"artifactLocation\":{\"uri\":\"");
+    append_uri(out, *this->location.file_name);
+
+    if (this->location.line == 0)
+    {
+        out.append("\"}}}]}\n");
+        return;
+    }
+
+    out.append("\"},\"region\":{\"startLine\":");
+    append_number(out, this->location.line);
+    out.append(",\"startColumn\":");
+    append_number(out, this->location.collum);
+    out.append(",\"byteOffset\":");
+    append_number(out, this->location.offset);
+    out.append(",\"byteLength\":");
+    append_number(out, this->location.size);
+    out.append("}}}]}\n");
+}
+
+
+
+EventHandler::~EventHandler()
+{
+    this->release_chunks();
+}
+
+
+void EventHandler::add_event(EventType type, MessageId message, SourceLocation location, std::string_view first, std::string_view second)
+{
+    if (type == EventType::ERROR)
+        this->error.store(true, std::memory_order_relaxed);
+
+    const uint32_t index = this->count.fetch_add(1, std::memory_order_relaxed);
+    Event& event = this->chunk_of(index)->events[index % chunk_size];
+
+    event.type = type;
+    event.message = message;
+    event.location = location;
+    event.arguments[0].assign(first);
+    event.arguments[1].assign(second);
+}
+
+
+void EventHandler::flush(std::ostream& stream, DiagnosticsFormat format)
+{
+    const uint32_t count = this->count.load(std::memory_order_acquire);
+
+    std::string text;
+    text.reserve(count * 96);
+
+    uint32_t index = 0;
+    for (Chunk* chunk = this->head.load(std::memory_order_acquire); chunk != nullptr && index < count; chunk = chunk->next.load(std::memory_order_acquire))
+        for (uint32_t i = 0; i < chunk_size && index < count; i++, index++)
+        {
+            // the SARIF results are items of an array
+            if (format == DiagnosticsFormat::SARIF && index > 0)
+                text.push_back(',');
+
+            chunk->events[i].format(text, format);
+        }
+
+    stream.write(text.data(), text.size());
+    stream.flush();
+
+    this->release_chunks();
+    this->count.store(0, std::memory_order_release);
+}
+
+
+std::string_view EventHandler::header(DiagnosticsFormat format)
+{
+    if (format != DiagnosticsFormat::SARIF)
+        return {};
+
+    // columns count UTF-8 characters, like in the text
+    return "{\"version\":\"2.1.0\","
+           "\"$schema\":\"https://json.schemastore.org/sarif-2.1.0.json\","
+           "\"runs\":[{\"tool\":{\"driver\":{\"name\":\"jts2gd\",\"version\":\"" JTS2GD_VERSION "\"}},"
+           "\"columnKind\":\"unicodeCodePoints\","
+           "\"results\":[\n";
+}
+
+
+std::string_view EventHandler::footer(DiagnosticsFormat format)
+{
+    if (format != DiagnosticsFormat::SARIF)
+        return {};
+
+    return "]}]}\n";
+}
+
+
+EventHandler::Chunk* EventHandler::chunk_of(uint32_t index)
+{
+    const uint32_t first = index - index % chunk_size;
+
+    // new events go to the last chunk (or the one after it), start the walk there
+    std::atomic<Chunk*>* link = &this->head;
+    uint32_t link_first = 0;
+
+    Chunk* hint = this->tail.load(std::memory_order_acquire);
+    if (hint != nullptr && hint->first <= first)
+    {
+        if (hint->first == first)
+            return hint;
+
+        link = &hint->next;
+        link_first = hint->first + chunk_size;
+    }
+
+    for (;; link_first += chunk_size)
+    {
+        Chunk* chunk = link->load(std::memory_order_acquire);
+
+        if (chunk == nullptr)
+        {
+            auto created = std::make_unique<Chunk>();
+            created->first = link_first;
+
+            if (link->compare_exchange_strong(chunk, created.get(), std::memory_order_acq_rel))
+                chunk = created.release();
+        }
+
+        if (chunk->first == first)
+        {
+            this->tail.store(chunk, std::memory_order_release);
+            return chunk;
+        }
+
+        link = &chunk->next;
+    }
+}
+
+
+void EventHandler::release_chunks()
+{
+    Chunk* chunk = this->head.exchange(nullptr, std::memory_order_acq_rel);
+    this->tail.store(nullptr, std::memory_order_release);
+
+    while (chunk != nullptr)
+    {
+        Chunk* next = chunk->next.load(std::memory_order_relaxed);
+        delete chunk;
+        chunk = next;
+    }
+}
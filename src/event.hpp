@@ -3,12 +3,11 @@
 
 
 // built-in
-#include <sstream>
-#include <list>
+#include <atomic>
+#include <cstdint>
 #include <iostream>
 #include <string>
-#include <cstdint>
-#include <vector>
+#include <string_view>
 
 // local
 #include "utils.hpp"
@@ -19,61 +18,102 @@
 //
 //
 //  Buffer for events detected during code analysis.
-//  
-//  Instead of sending events to 'stdin' in real time, 
-//  they are put on a list (for shorter insertion time) 
-//  and sent to 'stdin' in the same order they were 
-//  inserted during the 'flush' operation.
 //
-//  This class is also used to report an error detection 
+//  Instead of sending events to the output in real time, they are
+//  appended to a chunked buffer and written, in the same order they
+//  were added, by a single write during the 'flush' operation.
+//
+//  An event does not carry its text: it refers to one of the static
+//  messages below, plus the arguments that fill its '{}' slots (eg,
+//  the lexeme of an unexpected token). The text is only built by
+//  'flush'.
+//
+//  The events are written as colored text for the console, or for
+//  tools, as JSON Lines (one object per event) or SARIF. JSON is built
+//  by hand in the same buffer as the text, so a format costs the same
+//  as the other. SARIF wraps the results of every file of a run in one
+//  document: the caller writes its 'header' and 'footer' around the
+//  flushes, separating the non-empty ones with a comma.
+//
+//  Events can be added by several threads at once (eg, the jobs of a
+//  parallel compilation sharing a handler): a slot is reserved with a
+//  single atomic increment and chunks are linked without locks. 'flush'
+//  must not run while events are being added.
+//
+//  Events located at line 0 are about the whole file (eg, its
+//  compilation failed), the formats write them without a position.
+//
+//  This class is also used to report an error detection
 //  in one of the compiler passes (eg, do not generate code if there is a syntax error).
 //
 
 
-enum class EventType
+enum class EventType : uint8_t
 {
     WARNING,
     ERROR
 };
 
-const std::string EventTypeRepr[]
+
+enum class DiagnosticsFormat : uint8_t
 {
-    "WARNING",
-    "ERROR"
+    TEXT,
+    JSONL,
+    SARIF
 };
 
-const Color EventTypeColor[]
+
+// messages of the events, their names and texts are in 'event.cpp'
+enum class MessageId : uint8_t
 {
-    Color::FG_YELLOW,
-    Color::FG_LIGHT_RED
+    INVALID_CHAR,
+    UNEXPECTED_TOKEN,
+    UNEXPECTED_TOKEN_AFTER,
+    FOR_OF_WITHOUT_DECLARATION,
+    FOR_OF_MULTIPLE_VARIABLES,
+    FOR_OF_TYPED_VARIABLE,
+    FOR_OF_INITIALIZED_VARIABLE,
+    FOR_CONSTANCY,
+    LABELS,
+    IMPORT_STATEMENT,
+    WITH_STATEMENT,
+    INVALID_CASE_EXPRESSION,
+    EXCEPTIONS,
+    COMMA_OPERATOR,
+    ASSIGNMENT_VALUE,
+    ZERO_FILL_RIGHT_SHIFT_ASSIGNMENT,
+    ZERO_FILL_RIGHT_SHIFT,
+    UNSUPPORTED_OPERATOR,
+    POSTFIX_OPERATORS,
+    ELISION,
+    FUNCTION_EXPRESSIONS,
+    COMPILATION_FAILED,
+
+    COUNT
 };
 
 
 struct Event
 {
+    static constexpr uint32_t max_arguments = 2;
+
     EventType type;
-    const std::string message;
+    MessageId message;
     SourceLocation location;
+    std::string arguments[max_arguments]; // short lexemes fit without allocating
+
+    // appends the event (a line, with its line feed) to 'out'
+    void format(std::string& out, DiagnosticsFormat format) const;
+
+    private:
+
+        void format_text(std::string& out) const;
+        void format_json(std::string& out) const;
+        void format_sarif(std::string& out) const;
 
-    std::string repr() const
-    {
-        std::ostringstream event_repr;
-        int event_idx = (int)this->type;
-
-        event_repr << '[' 
-                   << get_color(EventTypeColor[event_idx])
-                   << EventTypeRepr[event_idx]
-                   << get_color(Color::FG_DEFAULT)
-                   << ']';
-                   
-        event_repr << '(' << this->location << "): ";
-        
-        event_repr << get_color(Color::FG_WHITE)
-                   << this->message
-                   << get_color(Color::FG_DEFAULT);
-
-        return event_repr.str();
-    }
+        // calls 'append' with every piece of the text of the message
+        template <class APPEND>
+        void write_message(APPEND append) const;
 };
 
 
@@ -81,45 +121,61 @@ class EventHandler
 {
     private:
 
-        std::list<Event> event_list;
-        bool error = false;
+        static constexpr uint32_t chunk_size = 128;
+
+        struct Chunk
+        {
+            uint32_t first; // index of its first event
+            Event events[chunk_size];
+            std::atomic<Chunk*> next {nullptr};
+        };
+
+        std::atomic<Chunk*> head {nullptr}; // created with the first event
+        std::atomic<Chunk*> tail {nullptr}; // hint of the last chunk, to not walk the list
+        std::atomic<uint32_t> count {0};
+        std::atomic<bool> error {false};
 
     public:
 
-        void add_error(const std::string message, SourceLocation location)
-        {
-            this->add_event({EventType::ERROR, std::move(message), location});
-        }
+        EventHandler() = default;
+        ~EventHandler();
+
+        EventHandler(const EventHandler&) = delete;
+        EventHandler& operator=(const EventHandler&) = delete;
 
-        void add_warning(const std::string message, SourceLocation location)
+        void add_error(MessageId message, SourceLocation location, std::string_view first = {}, std::string_view second = {})
         {
-            this->add_event({EventType::WARNING, std::move(message), location});
+            this->add_event(EventType::ERROR, message, location, first, second);
         }
 
-        void add_event(Event event)
+        void add_warning(MessageId message, SourceLocation location, std::string_view first = {}, std::string_view second = {})
         {
-            if (event.type == EventType::ERROR)
-                this->error = true;
-
-            this->event_list.push_back(std::move(event));
+            this->add_event(EventType::WARNING, message, location, first, second);
         }
 
-        void flush()
-        {
-            for (Event& event: this->event_list)
-                std::cout << event.repr() << '\n';
+        void add_event(EventType type, MessageId message, SourceLocation location, std::string_view first = {}, std::string_view second = {});
 
-            std::cout << std::flush;            
-            this->event_list.clear();
-        }
+        // writes every event to 'stream' and empties the buffer
+        void flush(std::ostream& stream = std::cout, DiagnosticsFormat format = DiagnosticsFormat::TEXT);
 
-        bool has_error() const 
+        // what goes before and after the flushes of a run (only SARIF has them)
+        static std::string_view header(DiagnosticsFormat format);
+        static std::string_view footer(DiagnosticsFormat format);
+
+        bool has_error() const
         {
-            return this->error;
+            return this->error.load(std::memory_order_relaxed);
         }
+
+    private:
+
+        // the chunk of the event at 'index', linked by the first thread that needs it
+        Chunk* chunk_of(uint32_t index);
+
+        void release_chunks();
 };
 
 
 
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,70 @@
+
+// built-in
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// local
+#include "file_table.hpp"
+
+
+
+// entries are allocated in chunks, so creating one never moves the others
+static constexpr uint32_t chunk_size = 256;
+
+static std::mutex table_mutex;
+static std::vector<uint16_t> closed_ids;
+static std::unique_ptr<SourceFile[]> chunks[FileTable::max_files / chunk_size];
+static uint32_t file_count = 0;
+
+
+
+uint16_t FileTable::open(const std::string& name, std::string_view text)
+{
+    uint16_t id;
+    {
+        std::lock_guard<std::mutex> lock {table_mutex};
+
+        if (!closed_ids.empty())
+        {
+            id = closed_ids.back();
+            closed_ids.pop_back();
+        }
+        else
+        {
+            if (file_count == max_files)
+                panic("too many source files");
+
+            id = file_count++;
+            if (id % chunk_size == 0)
+                chunks[id / chunk_size] = std::make_unique<SourceFile[]>(chunk_size);
+        }
+    }
+
+    SourceFile& file = FileTable::get(id);
+    file.name = name;
+    file.map = SourceMap{text};
+    return id;
+}
+
+
+void FileTable::close(uint16_t id)
+{
+    std::lock_guard<std::mutex> lock {table_mutex};
+    closed_ids.push_back(id);
+}
+
+
+SourceFile& FileTable::get(uint16_t id)
+{
+    return chunks[id / chunk_size][id % chunk_size];
+}
+
+
+SourceLocation FileTable::locate(uint16_t id, uint32_t offset, uint32_t size)
+{
+    SourceFile& file = FileTable::get(id);
+    const SourceMap::Position position = file.map.locate(offset);
+
+    return {&file.name, position.line, position.collum, offset, size, id};
+}
@@ -0,0 +1,62 @@
+#ifndef JTS2GD_FILE_TABLE
+#define JTS2GD_FILE_TABLE
+
+
+// built-in
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// local
+#include "utils.hpp"
+#include "source_map.hpp"
+
+
+//
+//  FileTable
+//
+//
+//  Table of the source files opened by the compiler, so a token can
+//  refer to its file with a 16-bit id instead of carrying a location.
+//
+//  Every compilation opens an entry of its own, even for a file that
+//  other jobs are compiling at the same time (or again, in watch mode),
+//  and closes it once its tokens are no longer used. Closed entries are
+//  reused by the files opened after. Lines and columns are resolved
+//  from the byte offsets only when a location is needed (diagnostics,
+//  '-t'), by the 'SourceMap' of the file.
+//
+//  Entries never move once created, so the ids (and the names pointed
+//  by 'SourceLocation's) stay valid while other threads open files.
+//  An entry is only used by the thread compiling its file, until it
+//  closes it.
+//
+
+
+struct SourceFile
+{
+    std::string name;
+    SourceMap map;
+};
+
+
+class FileTable
+{
+    public:
+
+        static constexpr uint32_t max_files = 1 << 16;
+
+        // gets an entry for a file and sets its name and content
+        static uint16_t open(const std::string& name, std::string_view text);
+
+        // gives the entry back, to be reused by another file
+        static void close(uint16_t id);
+
+        static SourceFile& get(uint16_t id);
+
+        // line and column (UTF-8 characters, from 1) of a byte offset of the file, 'size' bytes long
+        static SourceLocation locate(uint16_t id, uint32_t offset, uint32_t size = 0);
+};
+
+
+#endif
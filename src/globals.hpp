@@ -10,9 +10,11 @@
 
 //local
 #include "utils.hpp"
+#include "file_table.hpp"
+#include "symbol_table.hpp"
 
 
-enum class TokenType
+enum class TokenType : uint8_t
 {
     
     // ES5 keywords
@@ -238,24 +240,47 @@ const std::string TokenTypeRepr[]
 
 
 
+//  Tokens are kept small (16 bytes) so the parser touches as little
+//  memory as possible: the location is not stored, it is resolved from
+//  the offset of the lexeme in its file when needed (see 'FileTable').
+//
+//  Identifiers also carry their interned symbol, and so do the tokens
+//  generated by the parser, whose text is not part of the source.
 struct Token
 {
 
+    uint32_t offset;    // of the lexeme in the source
+    uint32_t size;      // of the lexeme in the source (0 for generated tokens)
+    Symbol symbol;      // 'SymbolTable::none' if it is not an identifier nor generated
+    uint16_t file;      // id in the 'FileTable'
     TokenType type;
-    std::string_view lexeme;
-    SourceLocation location;
+
+    std::string_view lexeme() const
+    {
+        if (this->symbol != SymbolTable::none)
+            return SymbolTable::name(this->symbol);
+
+        return FileTable::get(this->file).map.text().substr(this->offset, this->size);
+    }
+
+    SourceLocation location() const
+    {
+        return FileTable::locate(this->file, this->offset, this->size);
+    }
 
     std::string repr() const
     {
         std::ostringstream token_repr;
 
-        token_repr << this->location << ' ';
+        token_repr << this->location() << ' ';
         token_repr << TokenTypeRepr[(int)this->type] << ' ';
-        token_repr << '"' << this->lexeme << '"';
+        token_repr << '"' << this->lexeme() << '"';
 
         return token_repr.str();
     }
 };
 
+static_assert(sizeof(Token) == 16);
+
 
 #endif
\ No newline at end of file
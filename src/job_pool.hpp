@@ -0,0 +1,161 @@
+#ifndef JTS2GD_JOB_POOL
+#define JTS2GD_JOB_POOL
+
+
+// built-in
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+//
+//  JobPool
+//
+//
+//  Work-stealing thread pool used to compile independent files in parallel.
+//
+//  Every worker owns a queue. Submitted jobs are distributed between
+//  the queues in round-robin; a worker takes jobs from the front of its
+//  own queue and, when it runs dry, steals from the back of the others.
+//  This keeps the workers busy even when a few files are much larger
+//  than the rest of the batch.
+//
+//  Jobs must not throw. The destructor waits for every submitted job.
+//
+
+
+class JobPool
+{
+    private:
+
+        using Job = std::function<void()>;
+
+        struct WorkerQueue
+        {
+            std::mutex mutex;
+            std::deque<Job> jobs;
+        };
+
+        std::vector<std::unique_ptr<WorkerQueue>> queues;
+        std::vector<std::thread> threads;
+
+        std::mutex idle_mutex;
+        std::condition_variable idle_cond;
+        std::atomic<int32_t> queued {0};
+        bool stop = false;
+
+        uint32_t next_queue = 0;
+
+    public:
+
+        explicit JobPool(uint32_t worker_count)
+        {
+            if (worker_count == 0)
+                worker_count = 1;
+
+            for (uint32_t idx = 0; idx < worker_count; ++idx)
+                this->queues.push_back(std::make_unique<WorkerQueue>());
+
+            for (uint32_t idx = 0; idx < worker_count; ++idx)
+                this->threads.emplace_back([this, idx]() { this->work(idx); });
+        }
+
+        ~JobPool()
+        {
+            {
+                std::lock_guard lock {this->idle_mutex};
+                this->stop = true;
+            }
+            this->idle_cond.notify_all();
+
+            for (auto& thread: this->threads)
+                thread.join();
+        }
+
+        JobPool(const JobPool&) = delete;
+        JobPool& operator=(const JobPool&) = delete;
+
+        void submit(Job job)
+        {
+            auto& queue = *this->queues[this->next_queue];
+            this->next_queue = (this->next_queue + 1) % this->queues.size();
+
+            {
+                std::lock_guard lock {queue.mutex};
+                queue.jobs.push_back(std::move(job));
+            }
+
+            {
+                std::lock_guard lock {this->idle_mutex};
+                this->queued.fetch_add(1, std::memory_order_relaxed);
+            }
+            this->idle_cond.notify_one();
+        }
+
+    private:
+
+        void work(uint32_t own)
+        {
+            while (true)
+            {
+                Job job;
+
+                if (this->pop(own, job) || this->steal(own, job))
+                {
+                    job();
+                    continue;
+                }
+
+                // sleep until there is something to run (or the pool is being destroyed)
+                std::unique_lock lock {this->idle_mutex};
+                this->idle_cond.wait(lock, [this]() { return this->stop || this->queued.load(std::memory_order_relaxed) > 0; });
+
+                if (this->stop && this->queued.load(std::memory_order_relaxed) <= 0)
+                    return;
+            }
+        }
+
+        bool pop(uint32_t own, Job& job)
+        {
+            auto& queue = *this->queues[own];
+            std::lock_guard lock {queue.mutex};
+
+            if (queue.jobs.empty())
+                return false;
+
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+            this->queued.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        bool steal(uint32_t own, Job& job)
+        {
+            const uint32_t size = this->queues.size();
+
+            for (uint32_t offset = 1; offset < size; ++offset)
+            {
+                auto& queue = *this->queues[(own + offset) % size];
+                std::lock_guard lock {queue.mutex};
+
+                if (queue.jobs.empty())
+                    continue;
+
+                job = std::move(queue.jobs.back());
+                queue.jobs.pop_back();
+                this->queued.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+
+            return false;
+        }
+};
+
+
+#endif
@@ -3,60 +3,60 @@
 #include <memory>
 #include <memory_resource>
 #include <unordered_set>
-#include <typeinfo>
 #include <cstdint>
 
 // local
 #include "globals.hpp"
 #include "js_parser.hpp"
 #include "tree.hpp"
-#include "tree_releaser.hpp"
+#include "stats.hpp"
 
 
 
 //
 //  Javascript ES5 Parser
-//  
 //
-//  Some of the parser's functions keep objects allocated 
-//  in the heap inside 'unique_ptr's to ensure that in case 
-//  of an exception when calling another parser function, resources are not lost.
+//
+//  All nodes are created inside the arena of the 'Program'
+//  being parsed, so nothing needs to be released when a syntax
+//  error interrupts the parsing of a statement: the partial nodes
+//  are simply left behind and freed together with the rest of the tree.
+//
+//  Syntax errors are reported by returning nullptr (or false, for
+//  'consume' and 'expect'), which every caller propagates up to
+//  the statement loop, where the parser rewinds to the next
+//  statement.
+//
+//  The parser never backtracks: whether a '(' starts the parameters
+//  of an arrow function is decided beforehand by scanning the tokens
+//  ahead (see 'arrow_function_ahead').
 //
 
 
 
-
-// specialization of 'unique_ptr' which uses a custom destructor
-template <typename T>
-using unique_ptr = std::unique_ptr<T, UniqueReleaser<T>>;
-
-
-
-JSParser::JSParser(const std::vector<Token>& s, EventHandler& eh)
-: source(s), eh(&eh), source_size(source.size())
+JSParser::JSParser(TokenStream& tokens, EventHandler& eh)
+: tokens(tokens), eh(&eh)
 {
-    // initialize counter
-    this->idx = 0;
 }
 
 
 Program* JSParser::operator()()
 {
-    auto prog = new Program{};
+    JTS2GD_STATS_PHASE(PARSE);
+
+    // rough estimate of the size of the tree to avoid growing the arena many times
+    this->prog = new Program{this->tokens.source_bytes() * 8};
+    auto prog = this->prog;
 
     while (!this->at_end())
     {
-        try
-        {
-            prog->stmts.push_back(this->parse_stmt());
-        }
-        catch (const JSParser::SyntaxError&)
-        {
+        if (auto stmt = this->parse_stmt(); stmt != nullptr)
+            prog->stmts.push_back(stmt);
+        else
             this->parser_rewind();
-        }
     }
 
-    prog->function_expressions = std::move(this->function_expressions);
+    this->prog = nullptr;
     return prog;
 }
 
@@ -74,29 +74,48 @@ Statement* JSParser::parse_stmt()
     auto& tk = this->current_tok();
 
     // statement
-    const auto func_ptr = this->statement_first.find(tk.type);
-    if (func_ptr != this->statement_first.end())
-        return (this->*func_ptr->second)();
+    switch (tk.type)
+    {
+        case TokenType::VAR:
+        case TokenType::LET:
+        case TokenType::CONST:      return this->parse_var_decl_stmt();
+        case TokenType::SEMICOLON:  return this->parse_empty_stmt();
+        case TokenType::IF:         return this->parse_if_stmt();
+        case TokenType::FOR:        return this->parse_for_stmt();
+        case TokenType::WHILE:      return this->parse_while_stmt();
+        case TokenType::CONTINUE:   return this->parse_continue_stmt();
+        case TokenType::BREAK:      return this->parse_break_stmt();
+        case TokenType::IMPORT:     return this->parse_import_stmt();
+        case TokenType::RETURN:     return this->parse_return_stmt();
+        case TokenType::WITH:       return this->parse_with_stmt();
+        case TokenType::SWITH:      return this->parse_switch_case_stmt();
+        case TokenType::THROW:      return this->parse_throw_stmt();
+        case TokenType::TRY:        return this->parse_try_stmt();
+        case TokenType::FUNCTION:   return this->parse_function();
+        case TokenType::LEFT_BRACE: return this->parse_block();
+        case TokenType::EXTENDS:    return this->parse_extends();
+        case TokenType::CLASS:      return this->parse_class_extends();
+        default:                    break;
+    }
 
     // label
     if (this->match(TokenType::TWO_DOTS, 1))
         return this->parse_labeled_stmt();
 
     // expression
-    if (this->expr_first.find(tk.type) != this->expr_first.end())
+    if (this->expr_first.contains(tk.type))
         return this->parse_expression_stmt();
 
 
-    this->eh->add_error("unexpected token '" + std::string(tk.lexeme) + "'", tk.location);
-    throw JSParser::SyntaxError{};
+    return this->error(MessageId::UNEXPECTED_TOKEN, tk.location(), tk.lexeme());
 }
 
 
 
 Statement* JSParser::parse_var_decl_stmt()
 {
-    auto expr = unique_ptr<VarDeclStmt>(new VarDeclStmt{});
-    
+    auto expr = this->make<VarDeclStmt>();
+
     switch (this->current_tok().type)
     {
         case (TokenType::VAR):
@@ -119,48 +138,65 @@ Statement* JSParser::parse_var_decl_stmt()
     this->advance();
 
     // consumes at least one variable
-    do expr->decls.push_back(this->parse_var_decl());
+    do
+    {
+        auto decl = this->parse_var_decl();
+        if (decl == nullptr)
+            return nullptr;
+
+        expr->decls.push_back(decl);
+    }
     while (this->consume(TokenType::COMMA, false));
-    this->optional_semicolon();
 
-    return expr.release();
+    if (!this->optional_semicolon())
+        return nullptr;
+
+    return expr;
 }
 
 Statement* JSParser::parse_empty_stmt()
 {
     this->advance();
-    return new EmptyStmt{};
+    return this->make<EmptyStmt>();
 }
 
 Statement* JSParser::parse_labeled_stmt()
 {
-    this->eh->add_error("GDscript does not support labels", this->current_tok().location);
-    throw JSParser::SyntaxError{};
+    return this->error(MessageId::LABELS, this->current_tok().location());
 }
 
 Statement* JSParser::parse_if_stmt()
 {
-    auto expr = unique_ptr<IfStmt>(new IfStmt);
-    
-    this->consume(TokenType::IF);
-    this->consume(TokenType::LEFT_PAREM);
+    auto expr = this->make<IfStmt>();
+
+    if (!this->consume(TokenType::IF) || !this->consume(TokenType::LEFT_PAREM))
+        return nullptr;
+
     expr->cond = this->parse_expression();
-    this->consume(TokenType::RIGHT_PAREM);
+    if (expr->cond == nullptr || !this->consume(TokenType::RIGHT_PAREM))
+        return nullptr;
+
     expr->body = this->parse_stmt();
+    if (expr->body == nullptr)
+        return nullptr;
 
     // optional else part
     if (this->consume(TokenType::ELSE, false))
+    {
         expr->else_block = this->parse_stmt();
+        if (expr->else_block == nullptr)
+            return nullptr;
+    }
 
-    return expr.release();
+    return expr;
 }
 
 Statement* JSParser::parse_for_stmt()
 {
-    auto expr = unique_ptr<ForStmt>(new ForStmt{});
-    
-    this->consume(TokenType::FOR);
-    this->consume(TokenType::LEFT_PAREM);
+    auto expr = this->make<ForStmt>();
+
+    if (!this->consume(TokenType::FOR) || !this->consume(TokenType::LEFT_PAREM))
+        return nullptr;
 
     // for normal
 
@@ -169,8 +205,8 @@ Statement* JSParser::parse_for_stmt()
 
         if (this->match(TokenType::VAR) || this->match(TokenType::LET) || this->match(TokenType::CONST))
         {
-            auto vdecl_stmt = unique_ptr<VarDeclStmt>(new VarDeclStmt{});
-    
+            auto vdecl_stmt = this->make<VarDeclStmt>();
+
             switch (this->current_tok().type)
             {
                 case (TokenType::VAR):
@@ -193,68 +229,72 @@ Statement* JSParser::parse_for_stmt()
             this->advance();
 
             // consumes at least one variable
-            do vdecl_stmt->decls.push_back(this->parse_var_decl());
+            do
+            {
+                auto decl = this->parse_var_decl();
+                if (decl == nullptr)
+                    return nullptr;
+
+                vdecl_stmt->decls.push_back(decl);
+            }
             while (this->consume(TokenType::COMMA, false));
 
-            expr->init_expr = vdecl_stmt.release();
+            expr->init_expr = vdecl_stmt;
 
 
 
 
             if (this->match(TokenType::OF))
             {
-                if (static_cast<VarDeclStmt*>(expr->init_expr)->decls.size() > 1)
-                {
-                    this->eh->add_error("GDscript only allows a single variable to be declared in a for of loop", this->current_tok().location);
-                    throw JSParser::SyntaxError{};
-                }
+                if (vdecl_stmt->decls.size() > 1)
+                    return this->error(MessageId::FOR_OF_MULTIPLE_VARIABLES, this->current_tok().location());
 
-                if (static_cast<VarDeclStmt*>(expr->init_expr)->type == VarDeclStmtType::CONST)
-                    this->eh->add_warning("constancy cannot be ensured in for loops", this->current_tok().location);
+                if (vdecl_stmt->type == VarDeclStmtType::CONST)
+                    this->eh->add_warning(MessageId::FOR_CONSTANCY, this->current_tok().location());
 
-                for (auto vdecl: static_cast<VarDeclStmt*>(expr->init_expr)->decls)
+                for (auto vdecl: vdecl_stmt->decls)
                 {
-                    
+
                     if (vdecl->type != nullptr)
-                    {
-                        this->eh->add_error("GDscript does not support static typing on variables declared in for of loops", vdecl->type->location);
-                        throw JSParser::SyntaxError{};
-                    }
+                        return this->error(MessageId::FOR_OF_TYPED_VARIABLE, vdecl->type->location());
+
                     if (vdecl->init_value != nullptr)
-                    {
-                        this->eh->add_error("GDscript does not support initialization of variables in for of loops", vdecl->var->location);
-                        throw JSParser::SyntaxError{};
-                    }
+                        return this->error(MessageId::FOR_OF_INITIALIZED_VARIABLE, vdecl->var->location());
                 }
 
-                expr->init_var_decl = static_cast<VarDeclStmt*>(expr->init_expr)->decls[0]->var;
-                Releaser{}.visit(expr->init_expr);
-                
+                expr->init_var_decl = vdecl_stmt->decls[0]->var;
+                expr->init_expr = nullptr;
+
                 goto FOR_OF;
             }
         }
         else
         {
             expr->init_expr = this->parse_expression_stmt();
+            if (expr->init_expr == nullptr)
+                return nullptr;
+
             this->consume(TokenType::OF, false);
         }
 
-        if (!this->match(TokenType::SEMICOLON, -1))
-            this->consume(TokenType::SEMICOLON);
+        if (!this->match(TokenType::SEMICOLON, -1) && !this->consume(TokenType::SEMICOLON))
+            return nullptr;
     }
 
     if (!this->consume(TokenType::SEMICOLON, false))
     {
         expr->cond = this->parse_expression();
-        this->consume(TokenType::SEMICOLON);
+        if (expr->cond == nullptr || !this->consume(TokenType::SEMICOLON))
+            return nullptr;
     }
 
     if (!this->consume(TokenType::RIGHT_PAREM, false))
     {
         expr->post = this->parse_expression();
-        this->consume(TokenType::RIGHT_PAREM);
+        if (expr->post == nullptr || !this->consume(TokenType::RIGHT_PAREM))
+            return nullptr;
     }
-    
+
     goto BLOCK;
 
     // for in
@@ -262,114 +302,120 @@ Statement* JSParser::parse_for_stmt()
     FOR_OF:;
 
     expr->for_of = true;
-    this->consume(TokenType::OF);
+    if (!this->consume(TokenType::OF))
+        return nullptr;
+
     expr->of_expr = this->parse_expression();
-    this->consume(TokenType::RIGHT_PAREM);
+    if (expr->of_expr == nullptr || !this->consume(TokenType::RIGHT_PAREM))
+        return nullptr;
 
     BLOCK:;
 
     // loop body
     expr->block = this->parse_stmt();
+    if (expr->block == nullptr)
+        return nullptr;
 
-    return expr.release();
+    return expr;
 }
 
 Statement* JSParser::parse_while_stmt()
 {
-    auto expr = unique_ptr<WhileStmt>(new WhileStmt);
-    
-    this->consume(TokenType::WHILE);
-    this->consume(TokenType::LEFT_PAREM);
+    auto expr = this->make<WhileStmt>();
+
+    if (!this->consume(TokenType::WHILE) || !this->consume(TokenType::LEFT_PAREM))
+        return nullptr;
+
     expr->cond = this->parse_expression();
-    this->consume(TokenType::RIGHT_PAREM);
+    if (expr->cond == nullptr || !this->consume(TokenType::RIGHT_PAREM))
+        return nullptr;
 
     // body
     expr->body = this->parse_stmt();
+    if (expr->body == nullptr)
+        return nullptr;
 
-    return expr.release();
+    return expr;
 }
 
 Statement* JSParser::parse_continue_stmt()
 {
-    this->consume(TokenType::CONTINUE);
+    if (!this->consume(TokenType::CONTINUE))
+        return nullptr;
 
     // if there is no semicolon after the keyword
     if (!this->consume(TokenType::SEMICOLON, false))
     {
         // "insert" the semicolon if the next token is a '}' or EOF
         if (this->match(TokenType::RIGHT_BRACE) || this->match(TokenType::lEOF))
-            return new ContinueStmt{};
-        
+            return this->make<ContinueStmt>();
+
         // error if the next token is on the same line as the keyword
         else if (!this->separated_by_newline(this->current_tok(-1), this->current_tok()))
-        {
-            this->eh->add_error("GDscript does not support labels", this->current_tok().location);
-            throw JSParser::SyntaxError{};
-        }
+            return this->error(MessageId::LABELS, this->current_tok().location());
     }
 
-    return new ContinueStmt{};
+    return this->make<ContinueStmt>();
 }
 
 Statement* JSParser::parse_break_stmt()
 {
-    this->consume(TokenType::BREAK);
+    if (!this->consume(TokenType::BREAK))
+        return nullptr;
 
     // if there is no semicolon after the keyword
     if (!this->consume(TokenType::SEMICOLON, false))
     {
         // "insert" the semicolon if the next token is a '}' or EOF
         if (this->match(TokenType::RIGHT_BRACE) || this->match(TokenType::lEOF))
-            return new BreakStmt{};
-        
+            return this->make<BreakStmt>();
+
         // error if the next token is on the same line as the keyword
         else if (!this->separated_by_newline(this->current_tok(-1), this->current_tok()))
-        {
-            this->eh->add_error("GDscript does not support labels", this->current_tok().location);
-            throw JSParser::SyntaxError{};
-        }
+            return this->error(MessageId::LABELS, this->current_tok().location());
     }
 
-    return new BreakStmt{};
+    return this->make<BreakStmt>();
 }
 
 Statement* JSParser::parse_import_stmt()
 {
-    this->eh->add_error("GDscript does not support import statement", this->current_tok().location);
-    throw JSParser::SyntaxError{};
+    return this->error(MessageId::IMPORT_STATEMENT, this->current_tok().location());
 }
 
 Statement* JSParser::parse_return_stmt()
 {
-    this->consume(TokenType::RETURN);
+    if (!this->consume(TokenType::RETURN))
+        return nullptr;
 
     // if there is no semicolon after the keyword
     if (!this->consume(TokenType::SEMICOLON, false))
     {
         // "insert" the semicolon if the next token is a '}' or EOF
         if (this->match(TokenType::RIGHT_BRACE) || this->match(TokenType::lEOF))
-            return new ReturnStmt{};
-        
+            return this->make<ReturnStmt>();
+
         // parse the expression to be returned
         else if (!this->separated_by_newline(this->current_tok(-1), this->current_tok()))
         {
-            auto expr = unique_ptr<ReturnStmt>(new ReturnStmt{});
+            auto expr = this->make<ReturnStmt>();
             expr->value = this->parse_expression();
+            if (expr->value == nullptr)
+                return nullptr;
 
             // tries to consume the optional semicolon
             this->consume(TokenType::SEMICOLON, false);
 
-            return expr.release();
+            return expr;
         }
     }
 
-    return new ReturnStmt{};
+    return this->make<ReturnStmt>();
 }
 
 Statement* JSParser::parse_with_stmt()
 {
-    this->eh->add_error("GDscript does not support with statement", this->current_tok().location);
-    throw JSParser::SyntaxError{};
+    return this->error(MessageId::WITH_STATEMENT, this->current_tok().location());
 }
 
 
@@ -377,35 +423,39 @@ Case* JSParser::parse_case()
 {
     if (this->match(TokenType::CASE))
     {
-        
-        auto _case = unique_ptr<Case>(new Case{});
+
+        auto _case = this->make<Case>();
 
         // consumes sequence of cases clauses
         do
         {
-            this->consume(TokenType::CASE);
-            auto comp_val_location = this->current_tok().location; // save expression start location
-            auto comp_val = unique_ptr<Expression>(this->parse_expression());
-            
+            if (!this->consume(TokenType::CASE))
+                return nullptr;
+
+            const Token comp_val_start = this->current_tok(); // save expression start (its location is resolved on error)
+            auto comp_val = this->parse_expression();
+            if (comp_val == nullptr)
+                return nullptr;
+
             //
-            // expressions of switch clauses can be composed only 
+            // expressions of switch clauses can be composed only
             // of identifiers or access of identifiers with periods
             //
 
             bool valid_expr = true;
-            
+
             // guarantees that it is a primary expression
-            if (typeid(*comp_val) != typeid(PrimaryExpr))
+            if (comp_val->kind != NodeKind::PRIMARY_EXPR)
             {
                 valid_expr = false;
             }
             else
             {
                 // ensures that the primary expression is composed only of members access
-                PrimaryExpr* pexpr = static_cast<PrimaryExpr*>(comp_val.get());
+                PrimaryExpr* pexpr = static_cast<PrimaryExpr*>(comp_val);
                 for (auto part: pexpr->parts)
                 {
-                    if (typeid(*part) != typeid(MemberAccessPart))
+                    if (part->kind != NodeKind::MEMBER_ACCESS_PART)
                     {
                         valid_expr = false;
                         break;
@@ -414,201 +464,270 @@ Case* JSParser::parse_case()
             }
 
             if (!valid_expr)
-            {
-                this->eh->add_error("invalid case expression, only member access (\"A.B\") is allowed in GDScript", comp_val_location);
-                throw JSParser::SyntaxError{};
-            }
+                return this->error(MessageId::INVALID_CASE_EXPRESSION, comp_val_start.location());
 
-            _case->comp_values.push_back(comp_val.release());
-            this->consume(TokenType::TWO_DOTS);
+            _case->comp_values.push_back(comp_val);
+            if (!this->consume(TokenType::TWO_DOTS))
+                return nullptr;
 
         }
         while(this->match(TokenType::CASE));
 
         // parse clause body
-        do _case->stmts.push_back(this->parse_stmt());
+        do
+        {
+            auto stmt = this->parse_stmt();
+            if (stmt == nullptr)
+                return nullptr;
+
+            _case->stmts.push_back(stmt);
+        }
         while (!this->match(TokenType::CASE) && !this->match(TokenType::DEFAULT) && !this->match(TokenType::RIGHT_BRACE));
 
-        return _case.release();
+        return _case;
     }
 
     // consume "default" clause
     else if (this->match(TokenType::DEFAULT))
     {
-        this->consume(TokenType::DEFAULT);
-        this->consume(TokenType::TWO_DOTS);
-        
-        auto _case = unique_ptr<Case>(new Case{});
+        if (!this->consume(TokenType::DEFAULT) || !this->consume(TokenType::TWO_DOTS))
+            return nullptr;
+
+        auto _case = this->make<Case>();
 
         // parse clause body
-        do _case->stmts.push_back(this->parse_stmt());
+        do
+        {
+            auto stmt = this->parse_stmt();
+            if (stmt == nullptr)
+                return nullptr;
+
+            _case->stmts.push_back(stmt);
+        }
         while (!this->match(TokenType::CASE) && !this->match(TokenType::RIGHT_BRACE));
 
-        return _case.release();
+        return _case;
     }
     else
     {
         auto& tk = this->current_tok();
-        this->eh->add_error("unexpected token '" + std::string(tk.lexeme) + "'", tk.location);
-        throw JSParser::SyntaxError{};
+        return this->error(MessageId::UNEXPECTED_TOKEN, tk.location(), tk.lexeme());
     }
 }
 
 
 Statement* JSParser::parse_switch_case_stmt()
 {
-    auto expr = unique_ptr<SwitchCaseStmt>(new SwitchCaseStmt);
-    
-    this->consume(TokenType::SWITH);
-    this->consume(TokenType::LEFT_PAREM);
+    auto expr = this->make<SwitchCaseStmt>();
+
+    if (!this->consume(TokenType::SWITH) || !this->consume(TokenType::LEFT_PAREM))
+        return nullptr;
+
     expr->match_value = this->parse_expression();
-    this->consume(TokenType::RIGHT_PAREM);
-    
+    if (expr->match_value == nullptr || !this->consume(TokenType::RIGHT_PAREM))
+        return nullptr;
+
     // body
-    this->consume(TokenType::LEFT_BRACE);
+    if (!this->consume(TokenType::LEFT_BRACE))
+        return nullptr;
+
     while (!this->consume(TokenType::RIGHT_BRACE, false))
-        expr->case_clauses.push_back(this->parse_case());
+    {
+        auto _case = this->parse_case();
+        if (_case == nullptr)
+            return nullptr;
 
-    return expr.release();
+        expr->case_clauses.push_back(_case);
+    }
+
+    return expr;
 }
 
 Statement* JSParser::parse_throw_stmt()
 {
-    this->eh->add_error("GDscript does not support exceptions", this->current_tok().location);
-    throw JSParser::SyntaxError{};
+    return this->error(MessageId::EXCEPTIONS, this->current_tok().location());
 }
 
 Statement* JSParser::parse_try_stmt()
 {
-    this->eh->add_error("GDscript does not support exceptions", this->current_tok().location);
-    throw JSParser::SyntaxError{};
+    return this->error(MessageId::EXCEPTIONS, this->current_tok().location());
 }
 
 Statement* JSParser::parse_function()
 {
 
-    auto expr = unique_ptr<FunctionStmt>(new FunctionStmt{});
+    auto expr = this->make<FunctionStmt>();
+
+    if (!this->consume(TokenType::FUNCTION) || !this->consume(TokenType::IDENTIFIER))
+        return nullptr;
+
+    expr->name = this->keep(-1);
 
-    this->consume(TokenType::FUNCTION);
-    this->consume(TokenType::IDENTIFIER);
-    expr->name = &this->current_tok(-1);
+    if (!this->consume(TokenType::LEFT_PAREM))
+        return nullptr;
 
-    this->consume(TokenType::LEFT_PAREM);
     if (!this->match(TokenType::RIGHT_PAREM))
     {
         // parses function parameters
-        do expr->params.push_back(this->parse_var_decl());
+        do
+        {
+            auto param = this->parse_var_decl();
+            if (param == nullptr)
+                return nullptr;
+
+            expr->params.push_back(param);
+        }
         while (this->consume(TokenType::COMMA, false));
     }
-    this->consume(TokenType::RIGHT_PAREM);
+    if (!this->consume(TokenType::RIGHT_PAREM))
+        return nullptr;
 
     // parses the type if it exists
     if (this->consume(TokenType::TWO_DOTS, false))
     {
-        this->expect(TokenType::IDENTIFIER);
+        if (!this->expect(TokenType::IDENTIFIER))
+            return nullptr;
 
         // null type if "any" or "Any"
-        if (this->current_tok().lexeme != "any" && this->current_tok().lexeme != "Any")
-            expr->type = &this->current_tok();
-        
+        if (this->current_tok().lexeme() != "any" && this->current_tok().lexeme() != "Any")
+            expr->type = this->keep();
+
         this->advance();
     }
 
     // parse function body
-    this->consume(TokenType::LEFT_BRACE);
+    if (!this->consume(TokenType::LEFT_BRACE))
+        return nullptr;
+
     while (!this->match(TokenType::RIGHT_BRACE))
-        expr->func_body.push_back(this->parse_stmt());
-    this->consume(TokenType::RIGHT_BRACE);
+    {
+        auto stmt = this->parse_stmt();
+        if (stmt == nullptr)
+            return nullptr;
+
+        expr->func_body.push_back(stmt);
+    }
 
-    return expr.release();
+    if (!this->consume(TokenType::RIGHT_BRACE))
+        return nullptr;
+
+    return expr;
 }
 
 VarDecl* JSParser::parse_var_decl()
 {
-    auto decl = unique_ptr<VarDecl>(new VarDecl{});
+    auto decl = this->make<VarDecl>();
+
+    if (!this->consume(TokenType::IDENTIFIER))
+        return nullptr;
 
-    this->consume(TokenType::IDENTIFIER);
-    decl->var = &this->current_tok(-1);
+    decl->var = this->keep(-1);
 
     // parses the type if it exists
     if (this->consume(TokenType::TWO_DOTS, false))
     {
-        this->expect(TokenType::IDENTIFIER);
+        if (!this->expect(TokenType::IDENTIFIER))
+            return nullptr;
 
         // null type if "any" or "Any"
-        if (this->current_tok().lexeme != "any" && this->current_tok().lexeme != "Any")
-            decl->type = &this->current_tok();
+        if (this->current_tok().lexeme() != "any" && this->current_tok().lexeme() != "Any")
+            decl->type = this->keep();
 
         this->advance();
     }
 
     // parse initialization value if it exists
     if (this->consume(TokenType::EQUAL, false))
+    {
         decl->init_value = this->parse_assignment();
+        if (decl->init_value == nullptr)
+            return nullptr;
+    }
 
-    return decl.release();
+    return decl;
 }
 
 
 Statement* JSParser::parse_extends()
 {
-    auto expr = unique_ptr<ExtendsStmt>(new ExtendsStmt{});
+    auto expr = this->make<ExtendsStmt>();
 
-    this->consume(TokenType::EXTENDS);
+    if (!this->consume(TokenType::EXTENDS) || !this->consume(TokenType::IDENTIFIER))
+        return nullptr;
 
-    this->consume(TokenType::IDENTIFIER);
-    expr->name = &this->current_tok(-1);
-    this->optional_semicolon();
+    expr->name = this->keep(-1);
 
-    return expr.release();
+    if (!this->optional_semicolon())
+        return nullptr;
+
+    return expr;
 }
 
 Statement* JSParser::parse_class_extends()
 {
-    auto cext = unique_ptr<ClassExtendsStmt>(new ClassExtendsStmt{});
+    auto cext = this->make<ClassExtendsStmt>();
 
-    this->consume(TokenType::CLASS);
+    if (!this->consume(TokenType::CLASS) || !this->consume(TokenType::IDENTIFIER))
+        return nullptr;
 
-    this->consume(TokenType::IDENTIFIER);
-    cext->class_name = &this->current_tok(-1);
+    cext->class_name = this->keep(-1);
 
-    this->consume(TokenType::EXTENDS);
+    if (!this->consume(TokenType::EXTENDS) || !this->consume(TokenType::IDENTIFIER))
+        return nullptr;
 
-    this->consume(TokenType::IDENTIFIER);
-    cext->extended = &this->current_tok(-1);
+    cext->extended = this->keep(-1);
 
     // parse class body
-    this->consume(TokenType::LEFT_BRACE);
+    if (!this->consume(TokenType::LEFT_BRACE))
+        return nullptr;
+
     while (!this->match(TokenType::RIGHT_BRACE))
-        cext->body.push_back(this->parse_stmt());
-    this->consume(TokenType::RIGHT_BRACE);
+    {
+        auto stmt = this->parse_stmt();
+        if (stmt == nullptr)
+            return nullptr;
 
-    return cext.release();
+        cext->body.push_back(stmt);
+    }
+
+    if (!this->consume(TokenType::RIGHT_BRACE))
+        return nullptr;
+
+    return cext;
 
 }
 
 
 Statement* JSParser::parse_expression_stmt()
-{   
-    auto ptr = unique_ptr<ExpressionStmt>(new ExpressionStmt{});
+{
+    auto ptr = this->make<ExpressionStmt>();
+
     ptr->expr = this->parse_expression();
-    this->optional_semicolon();
+    if (ptr->expr == nullptr || !this->optional_semicolon())
+        return nullptr;
 
-    return ptr.release();
+    return ptr;
 }
 
 
 Statement* JSParser::parse_block()
 {
-    auto block = unique_ptr<Block>(new Block{});
+    auto block = this->make<Block>();
 
-    this->consume(TokenType::LEFT_BRACE);
+    if (!this->consume(TokenType::LEFT_BRACE))
+        return nullptr;
 
     // consume statements until you find the end of the block
     while (!this->consume(TokenType::RIGHT_BRACE, false))
-        block->stmts.push_back(this->parse_stmt());
+    {
+        auto stmt = this->parse_stmt();
+        if (stmt == nullptr)
+            return nullptr;
+
+        block->stmts.push_back(stmt);
+    }
 
-    return block.release();
+    return block;
 }
 
 
@@ -623,310 +742,364 @@ Statement* JSParser::parse_block()
 
 Expression* JSParser::parse_expression()
 {
-    auto expr = unique_ptr<Expression>(this->parse_assignment());
+    auto expr = this->parse_assignment();
+    if (expr == nullptr)
+        return nullptr;
 
     if (this->match(TokenType::COMMA))
-    {
-        this->eh->add_error("comma operator does not exist in GDscript", this->current_tok().location);
-        throw JSParser::SyntaxError{};
-    }
+        return this->error(MessageId::COMMA_OPERATOR, this->current_tok().location());
 
-    return expr.release();
+    return expr;
 }
 
 Expression* JSParser::parse_assignment()
 {
-    auto expr = unique_ptr<Expression>(this->parse_conditional_expr());
+    auto expr = this->parse_conditional_expr();
+    if (expr == nullptr)
+        return nullptr;
 
     const Token* tk = &this->current_tok();
-    if (this->assignment_operators.find(tk->type) != this->assignment_operators.end())
+    if (this->assignment_operators.contains(tk->type))
     {
+        BinaryExpr* new_expr = this->make<BinaryExpr>();
+        new_expr->oprt = this->keep();
         this->advance();
-        BinaryExpr* new_expr = new BinaryExpr{};
-        new_expr->oprt = tk;
-        new_expr->left = expr.release();
-        expr.reset(new_expr);
+        new_expr->left = expr;
+        expr = new_expr;
+
         new_expr->right = this->parse_conditional_expr();
+        if (new_expr->right == nullptr)
+            return nullptr;
 
         tk = &this->current_tok();
-        if (this->assignment_operators.find(tk->type) != this->assignment_operators.end())
-        {
-            this->eh->add_error("assignment returns nothing in GDScript", tk->location);
-            throw JSParser::SyntaxError{};
-        }
+        if (this->assignment_operators.contains(tk->type))
+            return this->error(MessageId::ASSIGNMENT_VALUE, tk->location());
     }
 
     if (this->match(TokenType::ZF_RIGHT_SHIFT_EQ))
-    {
-        this->eh->add_error("Operator zero fill right shift equal(>>>=) does not exist in GDScript", this->current_tok().location);
-        throw JSParser::SyntaxError{};
-    }
+        return this->error(MessageId::ZERO_FILL_RIGHT_SHIFT_ASSIGNMENT, this->current_tok().location());
 
-    return expr.release();
+    return expr;
 }
 
 Expression* JSParser::parse_conditional_expr()
 {
-    auto expr = unique_ptr<Expression>(this->parse_logical_or());
+    auto expr = this->parse_logical_or();
+    if (expr == nullptr)
+        return nullptr;
 
     if (this->match(TokenType::TERNARY))
     {
 
         this->advance();
-        auto new_expr = new ConditionalExpr{};
-        new_expr->cond = expr.release();
-        expr.reset(new_expr);
+        auto new_expr = this->make<ConditionalExpr>();
+        new_expr->cond = expr;
+        expr = new_expr;
 
         new_expr->expr1 = this->parse_expression();
-
-        this->consume(TokenType::TWO_DOTS);
+        if (new_expr->expr1 == nullptr || !this->consume(TokenType::TWO_DOTS))
+            return nullptr;
 
         new_expr->expr2 = this->parse_expression();
+        if (new_expr->expr2 == nullptr)
+            return nullptr;
     }
-    
-    return expr.release();
+
+    return expr;
 }
 
 Expression* JSParser::parse_logical_or()
 {
-    auto expr = unique_ptr<Expression>(this->parse_logical_and());
+    auto expr = this->parse_logical_and();
+    if (expr == nullptr)
+        return nullptr;
 
     while (this->match(TokenType::LOGICAL_OR))
     {
         this->advance();
-        BinaryExpr* new_expr = new BinaryExpr{};
-        new_expr->oprt = &this->current_tok(-1);
-        new_expr->left = expr.release();
-        expr.reset(new_expr);
+        BinaryExpr* new_expr = this->make<BinaryExpr>();
+        new_expr->oprt = this->keep(-1);
+        new_expr->left = expr;
+        expr = new_expr;
+
         new_expr->right = this->parse_logical_and();
+        if (new_expr->right == nullptr)
+            return nullptr;
     }
 
-    return expr.release();
+    return expr;
 }
 
 Expression* JSParser::parse_logical_and()
 {
-    auto expr = unique_ptr<Expression>(this->parse_or());
+    auto expr = this->parse_or();
+    if (expr == nullptr)
+        return nullptr;
 
     while (this->match(TokenType::LOGICAL_AND))
     {
         this->advance();
-        BinaryExpr* new_expr = new BinaryExpr{};
-        new_expr->oprt = &this->current_tok(-1);
-        new_expr->left = expr.release();
-        expr.reset(new_expr);
+        BinaryExpr* new_expr = this->make<BinaryExpr>();
+        new_expr->oprt = this->keep(-1);
+        new_expr->left = expr;
+        expr = new_expr;
+
         new_expr->right = this->parse_or();
+        if (new_expr->right == nullptr)
+            return nullptr;
     }
 
-    return expr.release();
+    return expr;
 }
 
 Expression* JSParser::parse_or()
 {
-    auto expr = unique_ptr<Expression>(this->parse_xor());
+    auto expr = this->parse_xor();
+    if (expr == nullptr)
+        return nullptr;
 
     while (this->match(TokenType::OR))
     {
         this->advance();
-        BinaryExpr* new_expr = new BinaryExpr{};
-        new_expr->oprt = &this->current_tok(-1);
-        new_expr->left = expr.release();
-        expr.reset(new_expr);
+        BinaryExpr* new_expr = this->make<BinaryExpr>();
+        new_expr->oprt = this->keep(-1);
+        new_expr->left = expr;
+        expr = new_expr;
+
         new_expr->right = this->parse_xor();
+        if (new_expr->right == nullptr)
+            return nullptr;
     }
 
-    return expr.release();
+    return expr;
 }
 
 Expression* JSParser::parse_xor()
 {
-    auto expr = unique_ptr<Expression>(this->parse_and());
+    auto expr = this->parse_and();
+    if (expr == nullptr)
+        return nullptr;
 
     while (this->match(TokenType::XOR))
     {
         this->advance();
-        BinaryExpr* new_expr = new BinaryExpr{};
-        new_expr->oprt = &this->current_tok(-1);
-        new_expr->left = expr.release();
-        expr.reset(new_expr);
+        BinaryExpr* new_expr = this->make<BinaryExpr>();
+        new_expr->oprt = this->keep(-1);
+        new_expr->left = expr;
+        expr = new_expr;
+
         new_expr->right = this->parse_and();
+        if (new_expr->right == nullptr)
+            return nullptr;
     }
 
-    return expr.release();
+    return expr;
 }
 
 Expression* JSParser::parse_and()
 {
-    auto expr = unique_ptr<Expression>(this->parse_equality());
+    auto expr = this->parse_equality();
+    if (expr == nullptr)
+        return nullptr;
 
     while (this->match(TokenType::AND))
     {
         this->advance();
-        BinaryExpr* new_expr = new BinaryExpr{};
-        new_expr->oprt = &this->current_tok(-1);
-        new_expr->left = expr.release();
-        expr.reset(new_expr);
+        BinaryExpr* new_expr = this->make<BinaryExpr>();
+        new_expr->oprt = this->keep(-1);
+        new_expr->left = expr;
+        expr = new_expr;
+
         new_expr->right = this->parse_equality();
+        if (new_expr->right == nullptr)
+            return nullptr;
     }
 
-    return expr.release();
+    return expr;
 }
 
 Expression* JSParser::parse_equality()
 {
-    auto expr = unique_ptr<Expression>(this->parse_relational());
+    auto expr = this->parse_relational();
+    if (expr == nullptr)
+        return nullptr;
 
     const Token* tk = &this->current_tok();
-    while (this->equality_operators.find(tk->type) != this->equality_operators.end())
+    while (this->equality_operators.contains(tk->type))
     {
+        BinaryExpr* new_expr = this->make<BinaryExpr>();
+        new_expr->oprt = this->keep();
         this->advance();
-        BinaryExpr* new_expr = new BinaryExpr{};
-        new_expr->oprt = tk;
-        new_expr->left = expr.release();
-        expr.reset(new_expr);
+        new_expr->left = expr;
+        expr = new_expr;
+
         new_expr->right = this->parse_relational();
+        if (new_expr->right == nullptr)
+            return nullptr;
+
         tk = &this->current_tok();
     }
 
-    return expr.release();
+    return expr;
 }
 
 Expression* JSParser::parse_relational()
 {
-    auto expr = unique_ptr<Expression>(this->parse_shift());
+    auto expr = this->parse_shift();
+    if (expr == nullptr)
+        return nullptr;
 
     const Token* tk = &this->current_tok();
-    while (this->relational_operators.find(tk->type) != this->relational_operators.end())
+    while (this->relational_operators.contains(tk->type))
     {
+        BinaryExpr* new_expr = this->make<BinaryExpr>();
+        new_expr->oprt = this->keep();
         this->advance();
-        BinaryExpr* new_expr = new BinaryExpr{};
-        new_expr->oprt = tk;
-        new_expr->left = expr.release();
-        expr.reset(new_expr);
+        new_expr->left = expr;
+        expr = new_expr;
+
         new_expr->right = this->parse_shift();
+        if (new_expr->right == nullptr)
+            return nullptr;
 
         tk = &this->current_tok();
     }
-    return expr.release();
+    return expr;
 }
 
 Expression* JSParser::parse_shift()
 {
-    auto expr = unique_ptr<Expression>(this->parse_additive());
+    auto expr = this->parse_additive();
+    if (expr == nullptr)
+        return nullptr;
 
     while (this->match(TokenType::LEFT_SHIFT) || this->match(TokenType::RIGHT_SHIFT))
     {
         this->advance();
-        BinaryExpr* new_expr = new BinaryExpr{};
-        new_expr->oprt = &this->current_tok(-1);
-        new_expr->left = expr.release();
-        expr.reset(new_expr);
+        BinaryExpr* new_expr = this->make<BinaryExpr>();
+        new_expr->oprt = this->keep(-1);
+        new_expr->left = expr;
+        expr = new_expr;
+
         new_expr->right = this->parse_additive();
+        if (new_expr->right == nullptr)
+            return nullptr;
     }
 
     if (this->match(TokenType::ZF_RIGHT_SHIFT))
-    {
-        this->eh->add_error("Operator zero fill right shift(>>>) does not exist in GDScript", this->current_tok().location);
-        throw JSParser::SyntaxError{};
-    }
+        return this->error(MessageId::ZERO_FILL_RIGHT_SHIFT, this->current_tok().location());
 
-    return expr.release();
+    return expr;
 }
 
 Expression* JSParser::parse_additive()
 {
-    auto expr = unique_ptr<Expression>(this->parse_multiplicative());
+    auto expr = this->parse_multiplicative();
+    if (expr == nullptr)
+        return nullptr;
 
     while (this->match(TokenType::PLUS) || this->match(TokenType::MINUS))
     {
         this->advance();
-        BinaryExpr* new_expr = new BinaryExpr{};
-        new_expr->oprt = &this->current_tok(-1);
-        new_expr->left = expr.release();
-        expr.reset(new_expr);
+        BinaryExpr* new_expr = this->make<BinaryExpr>();
+        new_expr->oprt = this->keep(-1);
+        new_expr->left = expr;
+        expr = new_expr;
+
         new_expr->right = this->parse_multiplicative();
+        if (new_expr->right == nullptr)
+            return nullptr;
     }
 
-    return expr.release();
+    return expr;
 }
 
 Expression* JSParser::parse_multiplicative()
 {
-    auto expr = unique_ptr<Expression>(this->parse_unary());
+    auto expr = this->parse_unary();
+    if (expr == nullptr)
+        return nullptr;
 
     while (this->match(TokenType::MUL) || this->match(TokenType::MOD) || this->match(TokenType::DIV))
     {
         this->advance();
-        BinaryExpr* new_expr = new BinaryExpr{};
-        new_expr->oprt = &this->current_tok(-1);
-        new_expr->left = expr.release();
-        expr.reset(new_expr);
+        BinaryExpr* new_expr = this->make<BinaryExpr>();
+        new_expr->oprt = this->keep(-1);
+        new_expr->left = expr;
+        expr = new_expr;
+
         new_expr->right = this->parse_unary();
+        if (new_expr->right == nullptr)
+            return nullptr;
     }
 
-    return expr.release();
+    return expr;
 }
 
 Expression* JSParser::parse_unary()
 {
     auto& tk = this->current_tok();
-    
-    if (this->unary_operators.find(tk.type) == this->unary_operators.end())
+
+    if (!this->unary_operators.contains(tk.type))
     {
         return this->parse_postfix();
     }
     else
     {
-        if (this->unsuported_unary_operators.find(tk.type) != this->unsuported_unary_operators.end())
-        {
-            this->eh->add_error("it is not possible to translate the '" + std::string(tk.lexeme) + "' operator to gdscript", tk.location);
-            throw JSParser::SyntaxError{};
-        }
+        if (this->unsuported_unary_operators.contains(tk.type))
+            return this->error(MessageId::UNSUPPORTED_OPERATOR, tk.location(), tk.lexeme());
 
-        auto expr = unique_ptr<UnaryExpr>(new UnaryExpr);
-        expr->oprt = &tk;
+        auto expr = this->make<UnaryExpr>();
+        expr->oprt = this->keep();
         this->advance();
 
         expr->value = this->parse_unary();
-        return expr.release();   
+        if (expr->value == nullptr)
+            return nullptr;
+
+        return expr;
     }
 }
 
 Expression* JSParser::parse_postfix()
 {
-    auto member_expr = unique_ptr<Expression>(this->parse_member_expr());
+    auto member_expr = this->parse_member_expr();
+    if (member_expr == nullptr)
+        return nullptr;
 
     if (this->match(TokenType::PLUS_PLUS) || this->match(TokenType::MINUS_MINUS))
-    {
-        this->eh->add_error("gdscript doesn't have posfix operators", this->current_tok().location);
-        throw JSParser::SyntaxError{};
-    }
+        return this->error(MessageId::POSTFIX_OPERATORS, this->current_tok().location());
 
-    return member_expr.release();
+    return member_expr;
 }
 
 
 
 Expression* JSParser::parse_member_expr()
 {
-    auto expr = unique_ptr<PrimaryExpr>(new PrimaryExpr{});
+    auto expr = this->make<PrimaryExpr>();
     auto& tk = this->current_tok();
 
     if (tk.type == TokenType::IDENTIFIER)
     {
         expr->type = PrimaryExprType::IDENTIFIER;
 
-        if (this->match(TokenType::ARROW, 1) || this->match(TokenType::TWO_DOTS, 1))
+        // "x => ..." or "x: type => ..."
+        if (this->match(TokenType::ARROW, 1) || (this->match(TokenType::TWO_DOTS, 1) && this->tokens.peek_ahead(3).type == TokenType::ARROW))
+        {
             expr->identifier = this->parse_function_expression();
+            if (expr->identifier == nullptr)
+                return nullptr;
+        }
         else
         {
-            expr->identifier = &tk;
+            expr->identifier = this->keep();
             this->advance();
         }
     }
-    else if (this->literal_member_first.find(tk.type) != this->literal_member_first.end())
+    else if (this->literal_member_first.contains(tk.type))
     {
-        expr->literal = &tk;
+        expr->literal = this->keep();
         expr->type = PrimaryExprType::LITERAL;
         this->advance();
     }
@@ -934,7 +1107,7 @@ Expression* JSParser::parse_member_expr()
     // array literal
     else if (tk.type == TokenType::LEFT_BRACKET)
     {
-        expr->array_members = new std::vector<Expression*>();
+        expr->array_members = this->prog->make_list<Expression*>();
         expr->type = PrimaryExprType::ARRAY_LITERAL;
 
         this->advance();
@@ -942,47 +1115,59 @@ Expression* JSParser::parse_member_expr()
         // if not empty...
         if (!this->consume(TokenType::RIGHT_BRACKET, false))
         {
-            expr->array_members->push_back(this->parse_assignment());
+            auto member = this->parse_assignment();
+            if (member == nullptr)
+                return nullptr;
+
+            expr->array_members->push_back(member);
 
             while (this->match(TokenType::COMMA))
             {
                 this->advance();
 
                 if (this->match(TokenType::COMMA))
-                {
-                    this->eh->add_error("elision of items in literal lists does not exist in GDscript", this->current_tok().location);
-                    throw JSParser::SyntaxError();
-                }
-                expr->array_members->push_back(this->parse_assignment());
+                    return this->error(MessageId::ELISION, this->current_tok().location());
+
+                member = this->parse_assignment();
+                if (member == nullptr)
+                    return nullptr;
+
+                expr->array_members->push_back(member);
             }
 
-            this->consume(TokenType::RIGHT_BRACKET);
+            if (!this->consume(TokenType::RIGHT_BRACKET))
+                return nullptr;
         }
     }
     else if (tk.type == TokenType::LEFT_PAREM)
     {
-        if (auto fname = this->parse_function_expression(true); fname != nullptr)
+        if (this->arrow_function_ahead())
         {
-            expr->identifier = fname;
+            expr->identifier = this->parse_function_expression();
             expr->type = PrimaryExprType::LITERAL;
+
+            if (expr->identifier == nullptr)
+                return nullptr;
         }
         else
         {
-            this->consume(TokenType::LEFT_PAREM);
+            if (!this->consume(TokenType::LEFT_PAREM))
+                return nullptr;
+
             expr->expr = this->parse_expression();
             expr->type = PrimaryExprType::EXPRESSION;
-            this->consume(TokenType::RIGHT_PAREM);
+
+            if (expr->expr == nullptr || !this->consume(TokenType::RIGHT_PAREM))
+                return nullptr;
         }
     }
     else if (tk.type == TokenType::FUNCTION)
     {
-        this->eh->add_error("function expressions does not exist in GDscript", tk.location);
-        throw JSParser::SyntaxError();
+        return this->error(MessageId::FUNCTION_EXPRESSIONS, tk.location());
     }
     else
     {
-        this->eh->add_error("unexpected token '" + std::string(tk.lexeme) + "'", tk.location);
-        throw JSParser::SyntaxError();
+        return this->error(MessageId::UNEXPECTED_TOKEN, tk.location(), tk.lexeme());
     }
 
     while (true)
@@ -992,21 +1177,26 @@ Expression* JSParser::parse_member_expr()
         {
             this->advance();
 
-            this->expect(TokenType::IDENTIFIER, "");
+            if (!this->expect(TokenType::IDENTIFIER))
+                return nullptr;
 
-            auto ptr = unique_ptr<MemberAccessPart>(new MemberAccessPart{});
-            ptr->member = &this->current_tok();
-            expr->parts.push_back(ptr.release());
+            auto ptr = this->make<MemberAccessPart>();
+            ptr->member = this->keep();
+            expr->parts.push_back(ptr);
             this->advance();
         }
-        
+
         // index
         else if (this->match(TokenType::LEFT_BRACKET))
         {
             this->advance();
-            auto ptr = unique_ptr<ArrayIndexPart>(new ArrayIndexPart{});
+            auto ptr = this->make<ArrayIndexPart>();
+
             ptr->index = this->parse_expression();
-            expr->parts.push_back(ptr.release());
+            if (ptr->index == nullptr)
+                return nullptr;
+
+            expr->parts.push_back(ptr);
             this->advance();
         }
 
@@ -1015,98 +1205,115 @@ Expression* JSParser::parse_member_expr()
         {
             this->advance();
 
-            auto call_ptr = unique_ptr<FunctionCallPart>(new FunctionCallPart{});
+            auto call_ptr = this->make<FunctionCallPart>();
 
             // stops if empty array literal
             if (this->consume(TokenType::RIGHT_PAREM, false))
             {
-                expr->parts.push_back(call_ptr.release());
+                expr->parts.push_back(call_ptr);
                 continue;
             }
 
-            do call_ptr->args.push_back(this->parse_assignment());
+            do
+            {
+                auto arg = this->parse_assignment();
+                if (arg == nullptr)
+                    return nullptr;
+
+                call_ptr->args.push_back(arg);
+            }
             while (this->consume(TokenType::COMMA, false));
-            
-            expr->parts.push_back(call_ptr.release());
-            this->consume(TokenType::RIGHT_PAREM);
+
+            expr->parts.push_back(call_ptr);
+            if (!this->consume(TokenType::RIGHT_PAREM))
+                return nullptr;
         }
         else
             break;
     }
 
-    return expr.release();
+    return expr;
 }
 
 
-const Token* JSParser::parse_function_expression(bool backtrack)
+//  Parses an arrow function, returning the token that names it.
+const Token* JSParser::parse_function_expression()
 {
-    auto original_idx = this->idx;
-    auto original_eh = this->eh;
-    EventHandler temp_handler;
+    auto fexpr = this->parse_arrow_function();
+    if (fexpr == nullptr)
+        return nullptr;
+
+    this->prog->function_expressions.push_back(fexpr);
+    return &fexpr->literal;
+}
+
+FunctionExpression* JSParser::parse_arrow_function()
+{
+    auto fexpr = this->make<FunctionExpression>();
+
+    // the generated name and its literal are interned, they are not part of the source
+    const Token& start = this->current_tok();
+    const std::string name = "__function_expression_" + std::to_string(this->fexpr_id++);
 
-    if (backtrack)
-        this->eh = &temp_handler;
+    fexpr->name = {start.offset, 0, SymbolTable::intern(name), start.file, TokenType::IDENTIFIER};
+    fexpr->literal = {start.offset, 0, SymbolTable::intern('"' + name + '"'), start.file, TokenType::STRING};
 
-    try
+    if (this->consume(TokenType::LEFT_PAREM, false))
     {
-        auto fexpr = unique_ptr<FunctionExpression>(new FunctionExpression{});
-
-        fexpr->name.type = TokenType::IDENTIFIER;
-        fexpr->name.location = this->current_tok().location;
-        fexpr->name_value = std::string("__function_expression_") + std::to_string(this->fexpr_id++);
-        fexpr->name.lexeme = fexpr->name_value;
-        
-        fexpr->literal.type = TokenType::STRING;
-        fexpr->literal.location = this->current_tok().location;
-        fexpr->literal_value = std::string("\"__function_expression_") + std::to_string(this->fexpr_id - 1) + '"';
-        fexpr->literal.lexeme = fexpr->literal_value;
-
-        if (this->consume(TokenType::LEFT_PAREM, false))
+        if (!this->match(TokenType::RIGHT_PAREM))
         {
-            if (!this->match(TokenType::RIGHT_PAREM))
+            // parses function parameters
+            do
             {
-                // parses function parameters
-                do fexpr->params.push_back(this->parse_var_decl());
-                while (this->consume(TokenType::COMMA, false));
+                auto param = this->parse_var_decl();
+                if (param == nullptr)
+                    return nullptr;
+
+                fexpr->params.push_back(param);
             }
-            this->consume(TokenType::RIGHT_PAREM);
-        }
-        else
-        {
-            fexpr->params.push_back(this->parse_var_decl());
+            while (this->consume(TokenType::COMMA, false));
         }
+        if (!this->consume(TokenType::RIGHT_PAREM))
+            return nullptr;
+    }
+    else
+    {
+        auto param = this->parse_var_decl();
+        if (param == nullptr)
+            return nullptr;
 
-        this->consume(TokenType::ARROW);
+        fexpr->params.push_back(param);
+    }
 
-        
-        // parse function body
-        if (this->consume(TokenType::LEFT_BRACE, false))
-        {
-            while (!this->match(TokenType::RIGHT_BRACE))
-                fexpr->func_body.push_back(this->parse_stmt());
-            this->consume(TokenType::RIGHT_BRACE);
-        }
-        else
+    if (!this->consume(TokenType::ARROW))
+        return nullptr;
+
+
+    // parse function body
+    if (this->consume(TokenType::LEFT_BRACE, false))
+    {
+        while (!this->match(TokenType::RIGHT_BRACE))
         {
-            fexpr->expression = this->parse_expression();
-            fexpr->expression_body = true;
+            auto stmt = this->parse_stmt();
+            if (stmt == nullptr)
+                return nullptr;
+
+            fexpr->func_body.push_back(stmt);
         }
 
-        auto name = &fexpr->literal;
-        this->function_expressions.push_back(fexpr.release());
-        return name;
+        if (!this->consume(TokenType::RIGHT_BRACE))
+            return nullptr;
     }
-    catch (const std::exception& error)
+    else
     {
-        if (backtrack)
-        {
-            this->idx = original_idx;
-            this->eh = original_eh;
+        fexpr->expression = this->parse_expression();
+        fexpr->expression_body = true;
+
+        if (fexpr->expression == nullptr)
             return nullptr;
-        }
-        else
-            throw error;
     }
+
+    return fexpr;
 }
 
 
@@ -1114,14 +1321,58 @@ const Token* JSParser::parse_function_expression(bool backtrack)
 
 
 
-bool JSParser::at_end(int offset) const
+//  Checks if the '(' at the current position opens the parameters
+//  of an arrow function, ie, if its matching ')' is followed by '=>'.
+//
+//  The whole group is scanned once: the parens nested in it are
+//  classified in the same pass and remembered, so each token is
+//  looked at only once however deep the nesting is.
+bool JSParser::arrow_function_ahead()
 {
-    return this->idx + offset >= this->source_size || this->match(TokenType::lEOF);
+    const uint64_t start = this->tokens.position();
+
+    if (start < this->scanned_until)
+        return this->arrow_parens.count(start) > 0;
+
+    this->arrow_parens.clear();
+    this->open_parens.clear();
+
+    uint32_t offset = 0;
+    do
+    {
+        const TokenType type = this->tokens.peek_ahead(offset).type;
+
+        if (type == TokenType::LEFT_PAREM)
+            this->open_parens.push_back(start + offset);
+
+        else if (type == TokenType::RIGHT_PAREM)
+        {
+            if (this->tokens.peek_ahead(offset + 1).type == TokenType::ARROW)
+                this->arrow_parens.insert(this->open_parens.back());
+            this->open_parens.pop_back();
+        }
+
+        // unbalanced, nothing after it is an arrow function
+        else if (type == TokenType::lEOF)
+            break;
+
+        ++offset;
+    }
+    while (!this->open_parens.empty());
+
+    this->scanned_until = start + offset;
+    return this->arrow_parens.count(start) > 0;
+}
+
+
+bool JSParser::at_end() const
+{
+    return this->match(TokenType::lEOF);
 }
 
 const Token& JSParser::current_tok(int offset) const
 {
-    return this->source[this->idx + offset];
+    return this->tokens.peek(offset);
 }
 
 bool JSParser::match(TokenType type, int offset) const
@@ -1131,24 +1382,38 @@ bool JSParser::match(TokenType type, int offset) const
 
 void JSParser::advance(int offset)
 {
-    this->idx += offset;
+    this->tokens.advance(offset);
+}
+
+const Token* JSParser::keep(int offset)
+{
+    return this->prog->copy_token(this->current_tok(offset));
 }
 
 
-void JSParser::optional_semicolon()
+bool JSParser::optional_semicolon()
 {
     if ((!this->consume(TokenType::SEMICOLON, false) && !this->match(TokenType::RIGHT_BRACE)) && !this->match(TokenType::lEOF))
         if (!this->separated_by_newline(this->current_tok(-1), this->current_tok()))
-            this->unexpected(this->current_tok());
+            return this->unexpected(this->current_tok());
+
+    return true;
+}
+
+std::nullptr_t JSParser::error(MessageId message, const SourceLocation& location, std::string_view argument)
+{
+    this->eh->add_error(message, location, argument);
+    return nullptr;
 }
 
-void JSParser::unexpected(const Token& tk, const std::string& message_end)
+bool JSParser::unexpected(const Token& tk, const std::string& message_end)
 {
     if (tk.type == TokenType::OF && message_end.empty())
-        this->eh->add_error("'for of' loops must contain a variable declaration, unexpected token '" + std::string(tk.lexeme) + "' " + message_end, tk.location);
+        this->eh->add_error(MessageId::FOR_OF_WITHOUT_DECLARATION, tk.location(), tk.lexeme(), message_end);
     else
-        this->eh->add_error("unexpected token '" + std::string(tk.lexeme) + "' " + message_end, tk.location);
-    throw JSParser::SyntaxError{};
+        this->eh->add_error(MessageId::UNEXPECTED_TOKEN_AFTER, tk.location(), tk.lexeme(), message_end);
+
+    return false;
 }
 
 bool JSParser::expect(TokenType type, bool error, const std::string& message_end)
@@ -1156,9 +1421,7 @@ bool JSParser::expect(TokenType type, bool error, const std::string& message_end
     if (!this->match(type))
     {
         if (error)
-        {
-            this->unexpected(this->current_tok(), message_end);
-        }
+            return this->unexpected(this->current_tok(), message_end);
         else
             return false;
     }
@@ -1169,7 +1432,7 @@ bool JSParser::expect(TokenType type, bool error, const std::string& message_end
 bool JSParser::consume(TokenType type, bool error, const std::string& message_end)
 {
     auto ret = this->expect(type, error, message_end);
-    
+
     if (ret)
         this->advance();
 
@@ -1179,24 +1442,26 @@ bool JSParser::consume(TokenType type, bool error, const std::string& message_en
 
 void JSParser::parser_rewind()
 {
+    JTS2GD_STATS_COUNT(REWINDS, 1);
+
     while (!this->at_end())
     {
         this->advance();
 
         auto& tk = this->current_tok();
-        const auto ptr = this->statement_first.find(tk.type);
-        if (ptr != this->statement_first.end()) // && ptr->first != TokenType::VAR && ptr->first != TokenType::SEMICOLON)
+        if (this->statement_first.contains(tk.type))
             break;
     }
 }
 
 bool JSParser::separated_by_newline(const Token& tk1, const Token& tk2) const
 {
-    const char* start = tk1.lexeme.data() + tk1.lexeme.size();
-    const char* end = tk2.lexeme.data();
+    const char* source = FileTable::get(tk1.file).map.text().data();
+    const char* start = source + tk1.offset + tk1.size;
+    const char* end = source + tk2.offset;
 
     for (; start != end; ++start)
         if (*start == '\n')
             return true;
     return false;
-}
\ No newline at end of file
+}
@@ -4,51 +4,89 @@
 
 // built-in
 #include <cstddef>
-#include <unordered_map>
 #include <unordered_set>
-#include <exception>
 #include <cstdint>
+#include <initializer_list>
 #include <memory_resource>
 #include <stack>
+#include <vector>
 
 // local
 #include "globals.hpp"
 #include "event.hpp"
 #include "tree.hpp"
+#include "token_stream.hpp"
 
 
 
 
 
 
+//
+//  TokenSet
+//
+//
+//  Set of token types stored as a bitset, so the tables of the parser
+//  are built at compile time and a lookup is a single bit test.
+//
+
+
+class TokenSet
+{
+    private:
+
+        static constexpr uint32_t word_bits = 64;
+
+        uint64_t words[2] = {0, 0};
+
+    public:
+
+        constexpr TokenSet(std::initializer_list<TokenType> types)
+        {
+            for (auto type: types)
+                this->words[(uint32_t)type / word_bits] |= (uint64_t)1 << ((uint32_t)type % word_bits);
+        }
+
+        [[nodiscard]]
+        constexpr bool contains(TokenType type) const
+        {
+            return (this->words[(uint32_t)type / word_bits] >> ((uint32_t)type % word_bits)) & 1;
+        }
+};
+
+static_assert((uint32_t)TokenType::lEOF < 128, "TokenSet holds at most 128 token types");
+
+
+
+
 class JSParser
 {
 
-    // table to choose function from the current token
-    const std::unordered_map<TokenType, Statement*(JSParser::*)(void)> statement_first
+    // tokens starting a statement with a function of its own (see 'parse_stmt')
+    static constexpr TokenSet statement_first
     {
-        {TokenType::VAR,        &JSParser::parse_var_decl_stmt},
-        {TokenType::LET,        &JSParser::parse_var_decl_stmt},
-        {TokenType::CONST,      &JSParser::parse_var_decl_stmt},
-        {TokenType::SEMICOLON,  &JSParser::parse_empty_stmt},
-        {TokenType::IF,         &JSParser::parse_if_stmt},
-        {TokenType::FOR,        &JSParser::parse_for_stmt},
-        {TokenType::WHILE,      &JSParser::parse_while_stmt},
-        {TokenType::CONTINUE,   &JSParser::parse_continue_stmt},
-        {TokenType::BREAK,      &JSParser::parse_break_stmt},
-        {TokenType::IMPORT,     &JSParser::parse_import_stmt},
-        {TokenType::RETURN,     &JSParser::parse_return_stmt},
-        {TokenType::WITH,       &JSParser::parse_with_stmt},
-        {TokenType::SWITH,      &JSParser::parse_switch_case_stmt},
-        {TokenType::THROW,      &JSParser::parse_throw_stmt},
-        {TokenType::TRY,        &JSParser::parse_try_stmt},
-        {TokenType::FUNCTION,   &JSParser::parse_function},
-        {TokenType::LEFT_BRACE, &JSParser::parse_block},
-        {TokenType::EXTENDS,    &JSParser::parse_extends},
-        {TokenType::CLASS,    &JSParser::parse_class_extends}
+        TokenType::VAR,
+        TokenType::LET,
+        TokenType::CONST,
+        TokenType::SEMICOLON,
+        TokenType::IF,
+        TokenType::FOR,
+        TokenType::WHILE,
+        TokenType::CONTINUE,
+        TokenType::BREAK,
+        TokenType::IMPORT,
+        TokenType::RETURN,
+        TokenType::WITH,
+        TokenType::SWITH,
+        TokenType::THROW,
+        TokenType::TRY,
+        TokenType::FUNCTION,
+        TokenType::LEFT_BRACE,
+        TokenType::EXTENDS,
+        TokenType::CLASS
     };
 
-    const std::unordered_set<TokenType> expr_first
+    static constexpr TokenSet expr_first
     {
         TokenType::IDENTIFIER,
         TokenType::LEFT_PAREM,
@@ -69,7 +107,7 @@ class JSParser
         TokenType::LEFT_BRACKET
     };
 
-    const std::unordered_set<TokenType> literal_member_first
+    static constexpr TokenSet literal_member_first
     {
         TokenType::INTEGER,
         TokenType::HEXA,
@@ -81,7 +119,7 @@ class JSParser
         TokenType::lNULL
     };
 
-    const std::unordered_set<TokenType> unary_operators
+    static constexpr TokenSet unary_operators
     {
         TokenType::DELETE,
         TokenType::VOID,
@@ -94,7 +132,7 @@ class JSParser
         TokenType::LOGICAL_NOT
     };
 
-    const std::unordered_set<TokenType> unsuported_unary_operators
+    static constexpr TokenSet unsuported_unary_operators
     {
         TokenType::DELETE,
         TokenType::VOID,
@@ -103,7 +141,7 @@ class JSParser
         TokenType::MINUS_MINUS,
     };
 
-    const std::unordered_set<TokenType> binary_operators
+    static constexpr TokenSet binary_operators
     {
         TokenType::MUL,
         TokenType::DIV,
@@ -130,13 +168,13 @@ class JSParser
         TokenType::LOGICAL_OR,
     };
 
-    const std::unordered_set<TokenType> unsuported_binary_operators
+    static constexpr TokenSet unsuported_binary_operators
     {
         TokenType::ZF_RIGHT_SHIFT,
         TokenType::ZF_RIGHT_SHIFT_EQ,
     };
 
-    const std::unordered_set<TokenType> relational_operators
+    static constexpr TokenSet relational_operators
     {
         TokenType::LESS_THAN,
         TokenType::GREATER_THAN,
@@ -145,8 +183,8 @@ class JSParser
         TokenType::INSTANCEOF,
         TokenType::IN
     };
-    
-    const std::unordered_set<TokenType> equality_operators
+
+    static constexpr TokenSet equality_operators
     {
         TokenType::EQ_EQ,
         TokenType::NOT_EQ,
@@ -154,7 +192,7 @@ class JSParser
         TokenType::NOT_EQ_EQ
     };
 
-    const std::unordered_set<TokenType> assignment_operators
+    static constexpr TokenSet assignment_operators
     {
         TokenType::EQUAL,
         TokenType::MUL_EQ,
@@ -169,29 +207,22 @@ class JSParser
         TokenType::OR_EQ
     };
 
-    struct SyntaxError: public std::exception
-    {
-        const char* what() const noexcept override
-        {
-            return "parser syntax error";
-        }
-    };
-
-
     private:
 
-        const std::vector<Token>& source;
+        TokenStream& tokens;
         EventHandler* eh;
 
-        uint32_t idx;
-        const size_t source_size;
-
         uint32_t fexpr_id = 0;
-        std::vector<FunctionExpression*> function_expressions;
+        Program* prog = nullptr; // program being parsed, owner of the arena
+
+        // parens already classified by 'arrow_function_ahead' (stream positions)
+        std::unordered_set<uint64_t> arrow_parens;
+        std::vector<uint64_t> open_parens;
+        uint64_t scanned_until = 0;
 
     public:
 
-        JSParser(const std::vector<Token>&, EventHandler&);
+        JSParser(TokenStream&, EventHandler&);
         Program* operator()();
 
     private:
@@ -238,7 +269,16 @@ class JSParser
 
         VarDecl* parse_var_decl();
         Case* parse_case();
-        const Token* parse_function_expression(bool = false);
+        const Token* parse_function_expression();
+        FunctionExpression* parse_arrow_function();
+        bool arrow_function_ahead();
+
+        // creates a node inside the arena of the program
+        template <typename T>
+        T* make()
+        {
+            return this->prog->template make<T>();
+        }
 
         // ####################################################
         // #                                                  #
@@ -247,7 +287,7 @@ class JSParser
         // ####################################################
 
         [[nodiscard]]
-        inline bool at_end(int = 0) const;
+        inline bool at_end() const;
 
         [[nodiscard]]
         inline const Token& current_tok(int = 0) const;
@@ -257,12 +297,18 @@ class JSParser
 
         inline void advance(int = 1);
 
+        // copies a token into the arena, so it can be stored in the tree
+        const Token* keep(int = 0);
+
         void parser_rewind();
 
+        // reports an error and returns nullptr, to be returned by the parse functions
+        std::nullptr_t error(MessageId, const SourceLocation&, std::string_view = {});
+
         bool expect(TokenType, bool = true, const std::string& = "");
         bool consume(TokenType, bool = true, const std::string& = "");
-        void unexpected(const Token&, const std::string& = "");
-        void optional_semicolon();
+        bool unexpected(const Token&, const std::string& = "");
+        bool optional_semicolon();
 
         [[nodiscard]]
         bool separated_by_newline(const Token&, const Token&) const;
@@ -1,6 +1,5 @@
 
 // built-in
-#include <cctype>
 #include <cstddef>
 #include <cstdlib>
 #include <string>
@@ -12,203 +11,157 @@
 
 // local
 #include "lexer.hpp"
+#include "scan.hpp"
 
 
 
-Lexer::Lexer(const std::string& source, EventHandler& eh, const std::string& source_name)
-: source(source), source_name(source_name), eh(eh), source_size(source.size())
+Lexer::Lexer(std::string_view source, EventHandler& eh, const std::string& source_name)
+: source(source), eh(eh), source_size(source.size())
 {
-    // initialize counters
+    // only offsets are tracked, lines and columns are resolved by the 'SourceMap' of the file
+    this->file = FileTable::open(source_name, source);
     this->idx = 0;
-    this->line = 1;
-    this->collum = 1; // most text editors count columns from 1
 }
 
-std::vector<Token> Lexer::operator()()
+Lexer::~Lexer()
 {
-    // ensure that the same lexer is not used more than once
-    assert(this->output.size() == 0);
+    FileTable::close(this->file);
+}
 
+//  Lexes the next token, skipping blanks and comments. After the
+//  end of the source it keeps returning the EOF token.
+Token Lexer::next()
+{
     while (!this->at_end())
-    {
-        int32_t ch = this->current_char();
-        this->read_token(ch);
-    }
+        if (auto tk = this->read_token(); tk.has_value())
+            return tk.value();
 
-    // inserting the EOF token
-    auto tk = Token
+    return Token
     {
-        TokenType::lEOF,
-        {this->source.data() + this->idx, 0}, // empty lexeme
-        {&this->source_name, this->line, this->collum}
+        this->idx, 0, // empty lexeme
+        SymbolTable::none,
+        this->file,
+        TokenType::lEOF
     };
-    this->output.push_back(std::move(tk));
+}
+
+std::vector<Token> Lexer::operator()()
+{
+    std::vector<Token> output;
+
+    do output.push_back(this->next());
+    while (output.back().type != TokenType::lEOF);
 
-    return std::move(this->output);
+    return output;
 }
 
 
-void Lexer::read_token(int32_t ch)
+//  Reads the token at the current position. Returns nothing for
+//  blanks, comments and invalid characters.
+std::optional<Token> Lexer::read_token()
 {
+    const uint8_t byte = this->source[this->idx];
 
-    // backup of the counters in case the first analysis fails
-    uint32_t start_idx = this->idx;
-    uint32_t start_line = this->line;
-    uint32_t start_collum = this->collum;
+    // multibyte characters are only valid inside strings and comments
+    if (byte >= 0x80)
+    {
+        this->eh.add_error(MessageId::INVALID_CHAR, FileTable::locate(this->file, this->idx, this->utf8_char_size(byte)));
+        this->idx += this->utf8_char_size(byte);
+        return {};
+    }
 
+    const uint8_t cclass = char_classes[byte];
+
+    if (cclass & CharClass::QUOTE)
     {
-        std::optional<Token> tk;
-    
-        if (ch == '"' || ch == '\'')
-            tk = this->lex_string(ch);
-    
-        else if (isdigit(ch))
-            tk = this->lex_number(ch);
-    
-        else if (isalpha(ch) || ch == '_')
-            tk = this->lex_identifier(ch);
+        return this->lex_string(byte);
+    }
 
-        // multi-char punctuation
-        else if (ispunct(ch) && this->l_ispunct(this->current_char(1)))
-            tk = this->lex_punctuation(ch);
-        
-        if (tk.has_value())
-        {
-            this->output.push_back(std::move(tk.value()));
-            return;
-        }
+    if (cclass & CharClass::DIGIT)
+    {
+        return this->lex_number(byte);
     }
-    
-    // backup of the counters in case the first analysis fails
-    this->idx = start_idx;
-    this->line = start_line;
-    this->collum = start_collum;
 
-    switch (ch)
+    if (cclass & CharClass::IDENT_START)
     {
-        case ('\t'):
-        case (' '):
-        case ('\v'):
-        case ('\f'):
-        {
-            this->advance(ch);
-            break;
-        }
+        return this->lex_identifier();
+    }
 
-        case ('\n'):
-        {
-            this->advance(ch);
-            break;
-        }
+    // consumes the whole sequence of blanks at once
+    if (cclass & CharClass::WHITESPACE)
+    {
+        this->advance_to(scan::skip_blanks(this->source.data() + this->idx));
+        return {};
+    }
 
-        case ('/'):
-        {
-            this->advance(ch);
+    // multi-char punctuation
+    if ((cclass & CharClass::PUNCT_START) && (char_classes[(uint8_t)this->source[this->idx + 1]] & CharClass::PUNCT_SECOND))
+    {
+        auto tk = this->lex_punctuation(byte);
 
-            // comment
-            if (!this->at_end() && this->match('/'))
-            {
-                this->advance('/');
-
-                if (this->match('g') && this->match('d', 1))
-                {
-                    this->advance('g');
-                    this->advance('d');
-                }
-                else
-                {
-                    while (ch = this->current_char(), !this->at_end() && ch != '\n')
-                        this->advance(ch);
-                }
-            }
-            else if (!this->at_end() && this->match('*'))
-            {
-                this->advance('*');
-
-                while (ch = this->current_char(), !this->at_end() && !(ch == '*' && this->match('/', 1)))
-                {
-                    this->advance(ch);
-                }
-                
-                if (!this->at_end())
-                {
-                    this->advance('*');
-                    this->advance('/');
-                }
-            }
+        if (tk.has_value())
+            return tk;
+    }
 
-            // div eq '/='
-            else if (!this->at_end() && this->match('='))
-            {
-                this->advance('=');
-                auto tk = Token
-                {
-                    TokenType::DIV_EQ,
-                    {this->source.data() + this->idx - 2, 2},
-                    {&this->source_name, this->line, this->collum - 2}
-                };
-                this->output.push_back(std::move(tk));
-            }
+    if (byte == '/')
+    {
+        this->advance('/');
 
-            // div
-            else
+        // comment
+        if (!this->at_end() && this->match('/'))
+        {
+            this->advance('/');
+
+            if (this->match('g') && this->match('d', 1))
             {
-                auto tk = Token
-                {
-                    TokenType::DIV,
-                    {this->source.data() + this->idx - 1, 1},
-                    {&this->source_name, this->line, this->collum - 1}
-                };
-                this->output.push_back(std::move(tk));
+                this->advance('g');
+                this->advance('d');
             }
-
-            break;
+            else
+                this->advance_to(scan::find(this->source.data() + this->idx, this->source.data() + this->source_size, '\n'));
         }
+        else if (!this->at_end() && this->match('*'))
+        {
+            this->advance('*');
 
+            const char* end = this->source.data() + this->source_size;
+            const char* comment_end = scan::find_comment_end(this->source.data() + this->idx, end);
+            this->advance_to(comment_end == end ? end : comment_end + 2);
+        }
 
-        // single-char punctuation
-        case ('-'):
-        case ('+'):
-        case ('('):
-        case (')'):
-        case ('['):
-        case (']'):
-        case ('='):
-        case ('*'):
-        case ('%'):
-        case ('>'):
-        case ('<'):
-        case (','):
-        case ('.'):
-        case (':'):
-        case (';'):
-        case ('?'):
-        case ('!'):
-        case ('{'):
-        case ('}'):
-        case ('~'):
-        case ('&'):
-        case ('^'):
-        case ('|'):
+        // div ('/=' is handled by 'lex_punctuation')
+        else
         {
             auto tk = Token
             {
-                single_char_tokens.at(ch),
-                {this->source.data() + this->idx, 1},
-                {&this->source_name, this->line, this->collum}
+                this->idx - 1, 1,
+                SymbolTable::none,
+                this->file,
+                TokenType::DIV
             };
-            this->output.push_back(std::move(tk));
-
-            this->advance(ch);
-            break;
+            return tk;
         }
 
-        default:
+        return {};
+    }
+
+    // single-char punctuation
+    if (cclass & CharClass::SINGLE_PUNCT)
+    {
+        auto tk = Token
         {
-            this->eh.add_error("invalid char", {&this->source_name, this->line, this->collum});
-            this->advance(ch);
-        }
+            this->idx, 1,
+            SymbolTable::none,
+            this->file,
+            single_char_tokens[byte]
+        };
+        ++this->idx;
+        return tk;
     }
+
+    this->eh.add_error(MessageId::INVALID_CHAR, FileTable::locate(this->file, this->idx, 1));
+    this->advance(byte);
+    return {};
 }
 
 // checks if the end of the file has already been reached
@@ -241,17 +194,13 @@ bool Lexer::match(int ch, int offset) const
 
 void Lexer::advance(int ch)
 {
-    if (ch == '\n')
-    {
-        ++this->line;
-        ++this->idx;
-        this->collum = 1;
-    }
-    else
-    {
-        this->idx += this->utf8_char_size(ch);
-        ++this->collum;
-    }
+    this->idx += this->utf8_char_size(ch);
+}
+
+// moves to 'target' (not before the current position)
+void Lexer::advance_to(const char* target)
+{
+    this->idx = target - this->source.data();
 }
 
 // parse utf-8 char size
@@ -274,30 +223,25 @@ uint8_t Lexer::utf8_char_size(uint8_t ch) const
 std::optional<Token> Lexer::lex_string(int32_t ch)
 {
     char string_start = ch;
-    SourceLocation location {&this->source_name, this->line, this->collum};
     uint32_t start_idx = this->idx;
 
-    while (true)
-    {
-        this->advance(ch);
-        ch = this->current_char();
-
-        // stop if it is at the end of the file or if it finds an unescaped finisher
-        if (this->at_end() || (ch == string_start && !this->match('\\', -1)))
-            break;
-    }
-    this->advance(ch);
+    const char* end = this->source.data() + this->source_size;
+    const char* finisher = this->source.data() + this->idx + 1;
 
+    // stops at an unescaped finisher or at the end of the file
+    while ((finisher = scan::find(finisher, end, string_start)) != end && finisher[-1] == '\\')
+        ++finisher;
 
+    this->advance_to(finisher == end ? end : finisher + 1);
 
-    char* start = (char*)this->source.data() + start_idx;
     uint32_t size = this->idx - start_idx;
 
     auto tk = Token
     {
-        TokenType::STRING,
-        {start, size},
-        location,
+        start_idx, size,
+        SymbolTable::none,
+        this->file,
+        TokenType::STRING
     };
     return {std::move(tk)};
 }
@@ -306,7 +250,6 @@ std::optional<Token> Lexer::lex_string(int32_t ch)
 std::optional<Token> Lexer::lex_number(int32_t ch)
 {
 
-    SourceLocation location {&this->source_name, this->line, this->collum};
     uint32_t start_idx = this->idx;
     char* start = (char*)this->source.data() + start_idx;
     char* end = nullptr;
@@ -320,7 +263,6 @@ std::optional<Token> Lexer::lex_number(int32_t ch)
         size = end - start;
         
         this->idx += size;
-        this->collum += size;
         
         if (!this->at_end() && this->match('.'))
         {
@@ -328,7 +270,6 @@ std::optional<Token> Lexer::lex_number(int32_t ch)
             size = end - (start + size);
             
             this->idx += size;
-            this->collum += size;
             
             type = TokenType::FLOAT;
         }
@@ -341,7 +282,6 @@ std::optional<Token> Lexer::lex_number(int32_t ch)
         size = end - start;
         
         this->idx += size;
-        this->collum += size;
         
         type = TokenType::HEXA;
     }
@@ -351,7 +291,6 @@ std::optional<Token> Lexer::lex_number(int32_t ch)
         size = end - start;
         
         this->idx += size;
-        this->collum += size;
         
         type = TokenType::OCTAL;
     }
@@ -360,101 +299,171 @@ std::optional<Token> Lexer::lex_number(int32_t ch)
     {
         Token
         {
-            type,
-            {start, this->idx - start_idx},
-            location
+            start_idx, this->idx - start_idx,
+            SymbolTable::none,
+            this->file,
+            type
         }
     };
 }
 
 
-std::optional<Token> Lexer::lex_identifier(int32_t ch)
+std::optional<Token> Lexer::lex_identifier()
 {
     uint32_t start_idx = this->idx;
-    SourceLocation location {&this->source_name, this->line, this->collum};
 
-    this->advance(ch);
-    while (ch = this->current_char(), !this->at_end() && (isalnum(ch) || ch == '_'))
-        this->advance(ch);
+    this->idx = scan::skip_identifier(this->source.data() + this->idx + 1) - this->source.data();
 
 
     const std::string_view lexeme {this->source.data() + start_idx, this->idx - start_idx};
-    TokenType type = TokenType::IDENTIFIER;
 
-    // check if it is a keyword
-    const auto type_ptr = multi_char_tokens.find(lexeme);
-    if (type_ptr != multi_char_tokens.end())
-        type = type_ptr->second;
+    const TokenType type = keyword_type(lexeme);
 
     return Token
     {
-        type,
-        lexeme,
-        location
+        start_idx, this->idx - start_idx,
+        type == TokenType::IDENTIFIER ? SymbolTable::intern(lexeme) : SymbolTable::none,
+        this->file,
+        type
     };
 }
 
 
-// custom punct function for multi-char punctuation
-bool Lexer::l_ispunct(int ch)
+//  Recognizes the longest multi-char punctuation starting at the
+//  current position. It is a trie unrolled in switches: the bytes 
+//  after the first one are read directly (the source is padded).
+//
+//  Returns nothing if it is not a multi-char punctuation.
+std::optional<Token> Lexer::lex_punctuation(uint8_t ch)
 {
+    const char* start = this->source.data() + this->idx;
+    const char second = start[1];
+    const char third = start[2];
+
+    TokenType type;
+    uint32_t size = 2;
+
     switch (ch)
     {
         case ('|'):
+        {
+            if (second == '|')
+                type = TokenType::LOGICAL_OR;
+            else if (second == '=')
+                type = TokenType::OR_EQ;
+            else
+                return {};
+            break;
+        }
         case ('&'):
+        {
+            if (second == '&')
+                type = TokenType::LOGICAL_AND;
+            else if (second == '=')
+                type = TokenType::AND_EQ;
+            else
+                return {};
+            break;
+        }
         case ('+'):
+        {
+            if (second == '+')
+                type = TokenType::PLUS_PLUS;
+            else if (second == '=')
+                type = TokenType::PLUS_EQ;
+            else
+                return {};
+            break;
+        }
         case ('-'):
+        {
+            if (second == '-')
+                type = TokenType::MINUS_MINUS;
+            else if (second == '=')
+                type = TokenType::MINUS_EQ;
+            else
+                return {};
+            break;
+        }
         case ('='):
-        case ('/'):
+        {
+            if (second == '=' && third == '=')
+                type = TokenType::EQ_EQ_EQ, size = 3;
+            else if (second == '=')
+                type = TokenType::EQ_EQ;
+            else if (second == '>')
+                type = TokenType::ARROW;
+            else
+                return {};
+            break;
+        }
+        case ('!'):
+        {
+            if (second == '=' && third == '=')
+                type = TokenType::NOT_EQ_EQ, size = 3;
+            else if (second == '=')
+                type = TokenType::NOT_EQ;
+            else
+                return {};
+            break;
+        }
         case ('<'):
+        {
+            if (second == '<' && third == '=')
+                type = TokenType::LEFT_SHIFT_EQ, size = 3;
+            else if (second == '<')
+                type = TokenType::LEFT_SHIFT;
+            else if (second == '=')
+                type = TokenType::LESS_THAN_EQ;
+            else
+                return {};
+            break;
+        }
         case ('>'):
         {
-            return true;
+            if (second == '>' && third == '>' && start[3] == '=')
+                type = TokenType::ZF_RIGHT_SHIFT_EQ, size = 4;
+            else if (second == '>' && third == '>')
+                type = TokenType::ZF_RIGHT_SHIFT, size = 3;
+            else if (second == '>' && third == '=')
+                type = TokenType::RIGHT_SHIFT_EQ, size = 3;
+            else if (second == '>')
+                type = TokenType::RIGHT_SHIFT;
+            else if (second == '=')
+                type = TokenType::GREATER_THAN_EQ;
+            else
+                return {};
+            break;
         }
-    }
-
-    return false;
-}
-
-std::optional<Token> Lexer::lex_punctuation(int32_t ch)
-{
-    uint32_t start_idx = this->idx;
-    SourceLocation location {&this->source_name, this->line, this->collum};
-
-    std::optional<Token> last_tk {};
-    uint32_t last_idx = this->idx;
-    uint32_t last_line = this->line;
-    uint32_t last_collum = this->collum;
-    
-    while (!this->at_end())
-    {
+        case ('*'):
+        case ('/'):
+        case ('%'):
+        case ('^'):
+        {
+            if (second != '=')
+                return {};
 
-        // checks if the current string forms a valid token
-        const std::string_view lexeme {this->source.data() + start_idx, this->idx - start_idx};
-        const auto type_ptr = multi_char_tokens.find(lexeme);
-        if (type_ptr != multi_char_tokens.end())
+            type = ch == '*' ? TokenType::MUL_EQ
+                 : ch == '/' ? TokenType::DIV_EQ
+                 : ch == '%' ? TokenType::MOD_EQ
+                 : TokenType::XOR_EQ;
+            break;
+        }
+        default:
         {
-            last_tk = Token
-            {
-                type_ptr->second,
-                lexeme,
-                location
-            };
-            last_idx = this->idx;
-            last_line = this->line;
-            last_collum = this->collum;
+            return {};
         }
+    }
 
-        // stop if the size exceeds the size of the largest punctuation token
-        if (lexeme.size() >= 4)
-            break;
+    auto tk = Token
+    {
+        this->idx, size,
+        SymbolTable::none,
+        this->file,
+        type
+    };
 
-        this->advance(ch);
-        ch = this->current_char();
-    }
+    this->idx += size;
 
-    this->idx = last_idx;
-    this->line = last_line;
-    this->collum = last_collum;
-    return last_tk;
-}
\ No newline at end of file
+    return tk;
+}
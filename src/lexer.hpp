@@ -3,12 +3,12 @@
 
 
 // built-in
-#include <cctype>
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <unordered_map>
 #include <optional>
+#include <array>
 #include <cstdint>
 
 // local
@@ -17,101 +17,201 @@
 
 
 
-// Table to identify a keyword and get its type
-const std::unordered_map<std::string_view, TokenType> multi_char_tokens
+//  Identifies a keyword and gets its type ('IDENTIFIER' if it is not a keyword).
+//
+//  Works as a perfect hash on (length, first char): each bucket holds 
+//  at most two keywords, so a lookup costs a couple of predictable 
+//  branches and one short comparison, without hashing the lexeme.
+constexpr TokenType keyword_type(std::string_view lexeme)
 {
-    {"this", TokenType::THIS},
-    {"new", TokenType::NEW},
-    {"delete", TokenType::DELETE},
-    {"void", TokenType::VOID},
-    {"typeof", TokenType::VOID},
-    {"instanceof", TokenType::INSTANCEOF},
-    {"in", TokenType::IN},
-    {"var", TokenType::VAR},
-    {"let", TokenType::LET},
-    {"const", TokenType::CONST},
-    {"if", TokenType::IF},
-    {"else", TokenType::ELSE},
-    {"do", TokenType::DO},
-    {"while", TokenType::WHILE},
-    {"for", TokenType::FOR},
-    {"of", TokenType::OF},
-    {"continue", TokenType::CONTINUE},
-    {"break", TokenType::BREAK},
-    {"return", TokenType::RETURN},
-    {"with", TokenType::WITH},
-    {"switch", TokenType::SWITH},
-    {"case", TokenType::CASE},
-    {"default", TokenType::DEFAULT},
-    {"throw", TokenType::THROW},
-    {"try", TokenType::TRY},
-    {"catch", TokenType::CATCH},
-    {"finally", TokenType::FINALLY},
-    {"function", TokenType::FUNCTION},
-    {"import", TokenType::IMPORT},
-    {"class", TokenType::CLASS},
-    {"null", TokenType::lNULL},
-    {"extends", TokenType::EXTENDS},
-
-    {"true", TokenType::TRUE},
-    {"false", TokenType::FALSE},
-
-    {"||", TokenType::LOGICAL_OR},
-    {"&&", TokenType::LOGICAL_AND},
-    {"++", TokenType::PLUS_PLUS},
-    {"--", TokenType::MINUS_MINUS},
-    {"==", TokenType::EQ_EQ},
-    {"!=", TokenType::NOT_EQ},
-    {">=", TokenType::GREATER_THAN_EQ},
-    {"<=", TokenType::LESS_THAN_EQ},
-    {"+=", TokenType::PLUS_EQ},
-    {"-=", TokenType::MINUS_EQ},
-    {"*=", TokenType::MUL},
-    {"/=", TokenType::DIV_EQ},
-    {"%/", TokenType::MOD_EQ},
-    {"|=", TokenType::OR_EQ},
-    {"&=", TokenType::AND_EQ},
-    {"^=", TokenType::XOR_EQ},
-    {"<<", TokenType::LEFT_SHIFT},
-    {">>", TokenType::RIGHT_SHIFT},
-    {"<<=", TokenType::LEFT_SHIFT_EQ},
-    {">>=", TokenType::RIGHT_SHIFT_EQ},
-    {">>>", TokenType::ZF_RIGHT_SHIFT},
-    {"===", TokenType::EQ_EQ_EQ},
-    {"!==", TokenType::NOT_EQ_EQ},
-    {">>>=", TokenType::ZF_RIGHT_SHIFT_EQ},
-    {"=>", TokenType::ARROW}
-};
+    auto check = [&lexeme](std::string_view keyword, TokenType type)
+    {
+        return lexeme == keyword ? type : TokenType::IDENTIFIER;
+    };
+
+    switch (lexeme.size())
+    {
+        case (2):
+        {
+            switch (lexeme[0])
+            {
+                case ('d'): return check("do", TokenType::DO);
+                case ('i'): return lexeme[1] == 'f' ? TokenType::IF : check("in", TokenType::IN);
+                case ('o'): return check("of", TokenType::OF);
+            }
+            break;
+        }
+        case (3):
+        {
+            switch (lexeme[0])
+            {
+                case ('n'): return check("new", TokenType::NEW);
+                case ('v'): return check("var", TokenType::VAR);
+                case ('l'): return check("let", TokenType::LET);
+                case ('f'): return check("for", TokenType::FOR);
+                case ('t'): return check("try", TokenType::TRY);
+            }
+            break;
+        }
+        case (4):
+        {
+            switch (lexeme[0])
+            {
+                case ('t'): return lexeme[1] == 'h' ? check("this", TokenType::THIS) : check("true", TokenType::TRUE);
+                case ('v'): return check("void", TokenType::VOID);
+                case ('e'): return check("else", TokenType::ELSE);
+                case ('w'): return check("with", TokenType::WITH);
+                case ('c'): return check("case", TokenType::CASE);
+                case ('n'): return check("null", TokenType::lNULL);
+            }
+            break;
+        }
+        case (5):
+        {
+            switch (lexeme[0])
+            {
+                case ('c'): return lexeme[1] == 'o' ? check("const", TokenType::CONST) : lexeme[1] == 'a' ? check("catch", TokenType::CATCH) : check("class", TokenType::CLASS);
+                case ('w'): return check("while", TokenType::WHILE);
+                case ('b'): return check("break", TokenType::BREAK);
+                case ('t'): return check("throw", TokenType::THROW);
+                case ('f'): return check("false", TokenType::FALSE);
+            }
+            break;
+        }
+        case (6):
+        {
+            switch (lexeme[0])
+            {
+                case ('d'): return check("delete", TokenType::DELETE);
+                case ('t'): return check("typeof", TokenType::TYPEOF);
+                case ('r'): return check("return", TokenType::RETURN);
+                case ('s'): return check("switch", TokenType::SWITH);
+                case ('i'): return check("import", TokenType::IMPORT);
+            }
+            break;
+        }
+        case (7):
+        {
+            switch (lexeme[0])
+            {
+                case ('d'): return check("default", TokenType::DEFAULT);
+                case ('f'): return check("finally", TokenType::FINALLY);
+                case ('e'): return check("extends", TokenType::EXTENDS);
+            }
+            break;
+        }
+        case (8):
+        {
+            switch (lexeme[0])
+            {
+                case ('c'): return check("continue", TokenType::CONTINUE);
+                case ('f'): return check("function", TokenType::FUNCTION);
+            }
+            break;
+        }
+        case (10):
+        {
+            return check("instanceof", TokenType::INSTANCEOF);
+        }
+    }
+
+    return TokenType::IDENTIFIER;
+}
+
+
+// single-char tokens, indexed by the (ASCII) character
+constexpr std::array<TokenType, 128> single_char_tokens = []()
+{
+    std::array<TokenType, 128> table {};
+
+    for (auto& type: table)
+        type = TokenType::lEOF; // not a single-char token
 
-// single-char tokens
-const std::unordered_map<int32_t, TokenType> single_char_tokens
+    table['-'] = TokenType::MINUS;
+    table['+'] = TokenType::PLUS;
+    table['('] = TokenType::LEFT_PAREM;
+    table[')'] = TokenType::RIGHT_PAREM;
+    table['['] = TokenType::LEFT_BRACKET;
+    table[']'] = TokenType::RIGHT_BRACKET;
+    table['='] = TokenType::EQUAL;
+    table['*'] = TokenType::MUL;
+    table['/'] = TokenType::DIV;
+    table['%'] = TokenType::MOD;
+    table['>'] = TokenType::GREATER_THAN;
+    table['<'] = TokenType::LESS_THAN;
+    table[','] = TokenType::COMMA;
+    table['.'] = TokenType::DOT;
+    table[':'] = TokenType::TWO_DOTS;
+    table[';'] = TokenType::SEMICOLON;
+    table['?'] = TokenType::TERNARY;
+    table['!'] = TokenType::LOGICAL_NOT;
+    table['{'] = TokenType::LEFT_BRACE;
+    table['}'] = TokenType::RIGHT_BRACE;
+    table['~'] = TokenType::NOT;
+    table['&'] = TokenType::AND;
+    table['^'] = TokenType::XOR;
+    table['|'] = TokenType::OR;
+
+    return table;
+}();
+
+
+//
+//  Character classes
+//
+//
+//  Every byte of the source is classified through a single 
+//  table lookup, instead of the (locale dependent) 'ctype' functions.
+//  A byte can belong to more than one class (eg, digits also continue 
+//  identifiers). Bytes with the high bit set are never part of a 
+//  class, they start a multibyte UTF-8 character.
+//
+struct CharClass
 {
-    {'-', TokenType::MINUS},
-    {'+', TokenType::PLUS},
-    {'(', TokenType::LEFT_PAREM},
-    {')', TokenType::RIGHT_PAREM},
-    {'[', TokenType::LEFT_BRACKET},
-    {']', TokenType::RIGHT_BRACKET},
-    {'=', TokenType::EQUAL},
-    {'*', TokenType::MUL},
-    {'/', TokenType::DIV},
-    {'%', TokenType::MOD},
-    {'>', TokenType::GREATER_THAN},
-    {'<', TokenType::LESS_THAN},
-    {',', TokenType::COMMA},
-    {'.', TokenType::DOT},
-    {':', TokenType::TWO_DOTS},
-    {';', TokenType::SEMICOLON},
-    {'?', TokenType::TERNARY},
-    {'!', TokenType::LOGICAL_NOT},
-    {'{', TokenType::LEFT_BRACE},
-    {'}', TokenType::RIGHT_BRACE},
-    {'~', TokenType::NOT},
-    {'&', TokenType::AND},
-    {'^', TokenType::XOR},
-    {'|', TokenType::OR}
+    static constexpr uint8_t WHITESPACE     = 1 << 0;
+    static constexpr uint8_t DIGIT          = 1 << 1;
+    static constexpr uint8_t IDENT_START    = 1 << 2;
+    static constexpr uint8_t IDENT_CONTINUE = 1 << 3;
+    static constexpr uint8_t PUNCT_START    = 1 << 4; // may start a multi-char punctuation
+    static constexpr uint8_t PUNCT_SECOND   = 1 << 5; // may be the second char of a multi-char punctuation
+    static constexpr uint8_t SINGLE_PUNCT   = 1 << 6;
+    static constexpr uint8_t QUOTE          = 1 << 7;
 };
 
+constexpr std::array<uint8_t, 256> char_classes = []()
+{
+    std::array<uint8_t, 256> table {};
+
+    for (int ch: {' ', '\t', '\v', '\f', '\n'})
+        table[ch] |= CharClass::WHITESPACE;
+
+    for (int ch = '0'; ch <= '9'; ++ch)
+        table[ch] |= CharClass::DIGIT | CharClass::IDENT_CONTINUE;
+
+    for (int ch = 'a'; ch <= 'z'; ++ch)
+        table[ch] |= CharClass::IDENT_START | CharClass::IDENT_CONTINUE;
+
+    for (int ch = 'A'; ch <= 'Z'; ++ch)
+        table[ch] |= CharClass::IDENT_START | CharClass::IDENT_CONTINUE;
+
+    table['_'] |= CharClass::IDENT_START | CharClass::IDENT_CONTINUE;
+
+    for (int ch: {'|', '&', '+', '-', '=', '!', '<', '>', '*', '/', '%', '^'})
+        table[ch] |= CharClass::PUNCT_START;
+
+    for (int ch: {'|', '&', '+', '-', '=', '/', '<', '>'})
+        table[ch] |= CharClass::PUNCT_SECOND;
+
+    for (int ch = 0; ch < 128; ++ch)
+        if (single_char_tokens[ch] != TokenType::lEOF)
+            table[ch] |= CharClass::SINGLE_PUNCT;
+
+    table['"'] |= CharClass::QUOTE;
+    table['\''] |= CharClass::QUOTE;
+
+    return table;
+}();
+
 
 
 class Lexer
@@ -119,24 +219,35 @@ class Lexer
 
     private:
 
-        const std::string& source;
-        const std::string& source_name; // eg, foobar.js
+        const std::string_view source;  // must be padded (see 'SourceBuffer')
         EventHandler& eh;
+        uint16_t file;                  // id in the 'FileTable'
         uint32_t idx;
-        uint32_t line;
-        uint32_t collum;
         const uint32_t source_size;
 
-        std::vector<Token> output;
-
     public:
 
-        Lexer(const std::string&, EventHandler&, const std::string&);
+        // the lexer owns the 'FileTable' entry of the source, its tokens must not outlive it
+        Lexer(std::string_view, EventHandler&, const std::string&);
+        ~Lexer();
+
+        Lexer(const Lexer&) = delete;
+        Lexer& operator=(const Lexer&) = delete;
+
+        // lexes the whole source at once
         std::vector<Token> operator()();
 
+        // lexes on demand (see 'TokenStream')
+        Token next();
+
+        size_t source_bytes() const
+        {
+            return this->source_size;
+        }
+
     private:
 
-        void read_token(int32_t);
+        std::optional<Token> read_token();
 
         [[nodiscard]]
         inline bool at_end() const;
@@ -148,16 +259,15 @@ class Lexer
         inline bool match(int, int = 0) const;
 
         inline void advance(int);
+        void advance_to(const char*);
 
         [[nodiscard]]
         inline uint8_t utf8_char_size(uint8_t) const;
 
         std::optional<Token> lex_string(int32_t);
         std::optional<Token> lex_number(int32_t);
-        std::optional<Token> lex_identifier(int32_t);
-        std::optional<Token> lex_punctuation(int32_t);
-
-        bool l_ispunct(int);
+        std::optional<Token> lex_identifier();
+        std::optional<Token> lex_punctuation(uint8_t);
 };
 
 
@@ -2,13 +2,19 @@
 // built-in
 #include <cctype>
 #include <exception>
-#include <filesystem>
-#include <fstream>
 #include <ios>
 #include <ostream>
 #include <string_view>
 #include <cstdint>
-#include <array>
+#include <optional>
+#include <future>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <utility>
+#include <filesystem>
+#include <system_error>
+#include <unordered_set>
 
 // extern
 #include "lib/CLI11.hpp"
@@ -16,87 +22,285 @@
 // local
 #include "event.hpp"
 #include "lexer.hpp"
+#include "token_stream.hpp"
 #include "js_parser.hpp"
 #include "tree_releaser.hpp"
 #include "tree_printer.hpp"
 #include "cgen.hpp"
+#include "job_pool.hpp"
+#include "source_buffer.hpp"
+#include "cache.hpp"
+#include "watch.hpp"
+#include "stats.hpp"
 
 
 
-std::string read_file(const std::string& path)
+struct CompileOptions
 {
-    if (!std::filesystem::exists(path) || !std::filesystem::is_regular_file(path))
-        panic("the file is invalid or does not exist");
-    
-    std::ifstream file (path);
+    bool print_tokens = false;
+    bool print_js = false;
+    bool stats = false;
+    bool map_sources = true; // false in watch mode, where the files may be truncated while mapped
+    DiagnosticsFormat diagnostics_format = DiagnosticsFormat::TEXT;
+    const BuildCache* cache = nullptr; // nullptr if the cache is disabled
+};
+
+
+//  Writes the diagnostics of a failed compilation to its log, followed
+//  by why it failed. With machine-readable diagnostics, the failure is
+//  one more diagnostic of the file (without a position), so it is in
+//  the same format and printed in order with the rest of the log.
+void report_failure(EventHandler& eh, const std::string& message, const std::string& input_path, const CompileOptions& options, std::ostream& log)
+{
+    if (options.diagnostics_format == DiagnosticsFormat::TEXT)
+    {
+        eh.flush(log, options.diagnostics_format);
+        report_error(log, message);
+        return;
+    }
 
-    if (file.bad() || !file.is_open())
-        panic("could not open the file");
+    eh.add_error(MessageId::COMPILATION_FAILED, {&input_path, 0, 0}, message);
+    eh.flush(log, options.diagnostics_format);
+}
 
-    
-    std::string output;
-    output.reserve((size_t)std::filesystem::file_size(path));
 
-    constexpr uint32_t buffer_size = 2048;
-    std::array<uint8_t, buffer_size> buffer;
+//  Prints the logs of the compiled files, in order. The SARIF results
+//  of every file go in a single document, so the printer writes its
+//  header and footer and separates the logs with results by a comma.
+class LogPrinter
+{
+    private:
 
+        DiagnosticsFormat format;
+        bool empty = true;
 
-    while (!file.eof())
-    {
-        file.read((char*)buffer.data(), buffer_size);
+    public:
 
-        output.insert(
-            output.end(),
-            std::make_move_iterator(buffer.begin()),
-            std::make_move_iterator(buffer.begin() + (ptrdiff_t)file.gcount()));
-    }
+        explicit LogPrinter(DiagnosticsFormat format)
+        : format(format)
+        {
+            std::cout << EventHandler::header(this->format) << std::flush;
+        }
 
-    file.close();
+        // whether the logs must be given to 'print' (else they can go straight to std::cout)
+        bool buffered() const
+        {
+            return this->format == DiagnosticsFormat::SARIF;
+        }
 
-    return output;
-}
+        void print(const std::string& log)
+        {
+            if (log.empty())
+                return;
+
+            if (this->buffered() && !this->empty)
+                std::cout << ',';
+
+            std::cout << log << std::flush;
+            this->empty = false;
+        }
+
+        void finish()
+        {
+            std::cout << EventHandler::footer(this->format) << std::flush;
+        }
+};
 
 
-void compile_file(const std::string& input_path, const std::string& output_path, bool ptokens, bool pjs)
+//  Compiles a single file. All the console output of the 
+//  compilation (diagnostics and debug prints) goes to 'log', 
+//  so that jobs running in parallel do not mix their messages.
+//
+//  Returns false if the compilation failed.
+bool compile(const std::string& input_path, const std::string& output_path, const CompileOptions& options, std::ostream& log)
 {
 
     EventHandler eh;
 
-    const std::string source = read_file(input_path);
-    auto lres = Lexer(source, eh, input_path)();
-
-    if (ptokens)
+    SourceBuffer source;
+    if (auto error = source.load(input_path, options.map_sources))
     {
-        for (auto& tk: lres)
-            std::cout << tk.repr() << '\n';
-        std::cout << std::flush;
+        report_failure(eh, error, input_path, options, log);
+        return false;
     }
 
-    if (eh.has_error())
+    // the debug prints need the passes to actually run
+    const bool use_cache = options.cache != nullptr && !options.print_tokens && !options.print_js;
+    std::string cache_key;
+
+    if (use_cache)
     {
-        eh.flush();
-        panic("errors found during lexical analysis. aborting");
+        cache_key = options.cache->key(input_path, source.view());
+        if (options.cache->restore(cache_key, output_path, log))
+        {
+            JTS2GD_STATS_COUNT(CACHE_HITS, 1);
+            return true;
+        }
     }
 
-    auto pres = JSParser(lres, eh)();
+    //  The lexer runs on demand, as the parser asks for tokens. Its errors
+    //  go to their own handler and, like before the parser existed in
+    //  the pipeline, abort the compilation before any parsing error.
+    EventHandler lexer_eh;
+    JTS2GD_STATS_COUNT(SOURCE_BYTES, source.view().size());
+
+    Lexer lexer {source.view(), lexer_eh, input_path};
+    TokenStream tokens {lexer, options.print_tokens ? &log : nullptr};
+
+    auto pres = JSParser(tokens, eh)();
 
+    if (options.print_tokens)
+        log << std::flush;
+
+    if (lexer_eh.has_error())
+    {
+        release_program(pres);
+        report_failure(lexer_eh, "errors found during lexical analysis. aborting", input_path, options, log);
+        return false;
+    }
 
     if (eh.has_error())
     {
-        eh.flush();
-        panic("errors found during parsing, aborting");
+        release_program(pres);
+        report_failure(eh, "errors found during parsing, aborting", input_path, options, log);
+        return false;
     }
     
-    if (pjs)
-        std::cout << print_tree(pres) << std::endl;
+    if (options.print_js)
+        log << print_tree(pres) << std::endl;
+
+    // the old output may be a hard link to a cache entry, it must not be written through
+    std::error_code remove_error;
+    std::filesystem::remove(output_path, remove_error);
 
-    std::ofstream output_file {output_path};
-    output_file << gen_gdscript(pres) << std::endl;
-    output_file.close();
+    CodeBuffer code {source.view().size()};
+    bool written = code.open(output_path);
+
+    if (written)
+    {
+        gen_gdscript(pres, code);
+        code.push_back('\n');
+        written = code.close();
+    }
 
     release_program(pres);
 
-    eh.flush();
+    // a partial output must not be taken for a good one
+    if (!written)
+    {
+        std::filesystem::remove(output_path, remove_error);
+
+        report_failure(eh, "could not write the output to '" + output_path + "'", input_path, options, log);
+        return false;
+    }
+
+    if (use_cache)
+    {
+        std::ostringstream diagnostics;
+        eh.flush(diagnostics, options.diagnostics_format);
+        log << diagnostics.str() << std::flush;
+
+        options.cache->store(cache_key, output_path, diagnostics.str());
+    }
+    else
+        eh.flush(log, options.diagnostics_format);
+
+    return true;
+}
+
+
+//  Compiles a single file (see 'compile') and, with '--stats', prints
+//  the stats of the compilation to 'stats_log' (the log itself with
+//  text diagnostics, which the stats must not mix with otherwise) and
+//  keeps them in 'file_stats', for the caller to add to the totals once
+//  the log is printed. With '--trace', its phases are recorded too.
+bool compile_file(const std::string& input_path, const std::string& output_path, const CompileOptions& options, std::ostream& log, [[maybe_unused]] std::ostream& stats_log, [[maybe_unused]] stats::FileStats& file_stats)
+{
+#ifdef JTS2GD_ENABLE_STATS
+    if (options.stats || stats::tracing())
+    {
+        bool success;
+        {
+            stats::FileRecorder recorder {file_stats, input_path};
+            success = compile(input_path, output_path, options, log);
+        }
+
+        if (!options.stats)
+            return success;
+
+        stats_log << stats::table(input_path, file_stats) << std::flush;
+        return success;
+    }
+#endif
+
+    return compile(input_path, output_path, options, log);
+}
+
+
+//  Compiles the files in a 'JobPool'.
+//
+//  The log of each file is buffered and printed in the same 
+//  order of the input, so the output is the same as a sequential 
+//  compilation. Like in the sequential compilation, nothing after 
+//  the first file that fails is reported, and the files after it 
+//  that have not started yet are skipped.
+//
+//  Returns false if any compilation failed.
+bool compile_files_parallel(const std::vector<std::pair<std::string, std::string>>& files, uint32_t jobs, const CompileOptions& options, LogPrinter& printer)
+{
+    const uint32_t size = files.size();
+
+    std::vector<std::ostringstream> logs (size);
+    std::vector<std::ostringstream> stats_logs (size); // only used without text diagnostics
+    std::vector<stats::FileStats> file_stats (size);
+    std::vector<std::promise<bool>> results (size);
+    std::vector<std::future<bool>> finished;
+    std::atomic<uint32_t> first_failure {size};
+
+    for (auto& result: results)
+        finished.push_back(result.get_future());
+
+    {
+        JobPool pool {std::min(jobs, size)};
+
+        for (uint32_t idx = 0; idx < size; ++idx)
+        {
+            pool.submit([&, idx]()
+            {
+                if (idx > first_failure.load(std::memory_order_relaxed))
+                {
+                    results[idx].set_value(false);
+                    return;
+                }
+
+                std::ostream& stats_log = options.diagnostics_format == DiagnosticsFormat::TEXT ? logs[idx] : stats_logs[idx];
+                bool success = compile_file(files[idx].first, files[idx].second, options, logs[idx], stats_log, file_stats[idx]);
+                if (!success)
+                {
+                    uint32_t current = first_failure.load();
+                    while (idx < current && !first_failure.compare_exchange_weak(current, idx));
+                }
+
+                results[idx].set_value(success);
+            });
+        }
+
+        // print the logs in order while the remaining jobs are still running
+        for (uint32_t idx = 0; idx < size; ++idx)
+        {
+            bool success = finished[idx].get();
+            printer.print(logs[idx].str());
+            std::cerr << stats_logs[idx].str() << std::flush;
+
+            if (options.stats)
+                stats::add_to_totals(file_stats[idx]);
+
+            if (!success)
+                break;
+        }
+    }
+
+    return first_failure.load() == size;
 }
 
 
@@ -107,13 +311,30 @@ int main(int argc, char** argv)
     std::string output_file;
     bool print_tokens = false;
     bool print_JS = false;
+    uint32_t jobs = 1;
+    bool use_cache = false;
+    std::string cache_dir = ".jts2gd-cache";
+    bool watch = false;
+    std::string diagnostics_format = "text";
+    bool print_stats = false;
+    std::string trace_file;
 
 
     CLI::App program {"JTS2GD"};
-    program.add_option("files", input_files, "files to be compiled");
+    program.add_option("files", input_files, "files to be compiled (\"-\" reads from stdin)");
     program.add_option("-o, --output", output_file, "place to put the output");
     program.add_flag("-t, --tokens", print_tokens, "print the sequence of tokens recognized by lexer");
     program.add_flag("-j, --javascript", print_JS, "print the structure recognized by the parser in Javascript, for debug purposes only");
+    program.add_option("-J, --jobs", jobs, "number of files compiled in parallel (0 uses all the cores)");
+    program.add_flag("-c, --cache", use_cache, "reuse the outputs of unchanged files from previous compilations");
+    program.add_option("--cache-dir", cache_dir, "directory of the cache (default: .jts2gd-cache)");
+    program.add_flag("-w, --watch", watch, "keep running and recompile the files when they change");
+    program.add_option("--diagnostics-format", diagnostics_format, "format of the warnings and errors: text, jsonl or sarif (default: text)")
+        ->check(CLI::IsMember({"text", "jsonl", "sarif"}));
+#ifdef JTS2GD_ENABLE_STATS
+    program.add_flag("--stats", print_stats, "print the time spent in each phase and counters of every file, and their totals");
+    program.add_option("--trace", trace_file, "write the phases of every file, by thread, to a trace (Chrome trace-event format)");
+#endif
 
 
     CLI11_PARSE(program, argc, argv);
@@ -125,19 +346,145 @@ int main(int argc, char** argv)
     if (!output_file.empty() && input_files.size() > 1)
         panic("output is not supported with multiple files");
 
+    if (jobs == 0)
+        jobs = std::max(1u, std::thread::hardware_concurrency());
+
+    // a SARIF document is only complete once every file is compiled
+    if (watch && diagnostics_format == "sarif")
+        panic("SARIF diagnostics are not supported in watch mode");
+
+
+    // (input, output) pairs
+    std::vector<std::pair<std::string, std::string>> files;
 
     if (input_files.size() == 1 && !output_file.empty())
     {
-        compile_file(input_files.at(0), output_file, print_tokens, print_JS);
+        files.emplace_back(input_files.at(0), output_file);
     }
     else
     {
         for (auto& file: input_files)
         {
+            if (file == "-")
+                panic("the output must be specified when compiling from stdin");
+
             auto ext_start = file.find_last_of('.');
             std::string filename (file.begin(), file.begin() + ext_start);
 
-            compile_file(file, filename + ".gd", print_tokens, print_JS);
+            files.emplace_back(file, filename + ".gd");
+        }
+    }
+
+    // jobs compiling the same file (or two files with the same output) would write the same output at once
+    std::unordered_set<std::string> outputs;
+    for (auto& [input, output]: files)
+        if (!outputs.insert(std::filesystem::path{output}.lexically_normal().string()).second)
+            panic("'" + output + "' would be written by more than one input ('" + input + "' is repeated or has the same output as another one)");
+
+
+    CompileOptions options;
+    options.print_tokens = print_tokens;
+    options.print_js = print_JS;
+    options.stats = print_stats;
+    options.map_sources = !watch;
+
+    if (diagnostics_format == "jsonl")
+        options.diagnostics_format = DiagnosticsFormat::JSONL;
+    else if (diagnostics_format == "sarif")
+        options.diagnostics_format = DiagnosticsFormat::SARIF;
+
+    // the cached diagnostics are written in the format of the compilation that stored them
+    std::optional<BuildCache> cache;
+    if (use_cache)
+        cache.emplace(cache_dir, "diagnostics-format=" + diagnostics_format);
+
+    options.cache = cache ? &cache.value() : nullptr;
+
+
+#ifdef JTS2GD_ENABLE_STATS
+    if (!trace_file.empty())
+        stats::start_trace();
+#endif
+
+    LogPrinter printer {options.diagnostics_format};
+    bool success;
+
+    if (jobs > 1 && files.size() > 1)
+    {
+        success = compile_files_parallel(files, jobs, options, printer);
+    }
+    else
+    {
+        success = true;
+        for (auto& [input, output]: files)
+        {
+            std::ostringstream log;
+            std::ostream& file_log = printer.buffered() ? log : std::cout;
+            stats::FileStats file_stats;
+
+            success = compile_file(input, output, options, file_log, options.diagnostics_format == DiagnosticsFormat::TEXT ? file_log : std::cerr, file_stats);
+            printer.print(log.str());
+
+            if (options.stats)
+                stats::add_to_totals(file_stats);
+
+            if (!success)
+                break;
+        }
+    }
+
+    printer.finish();
+
+#ifdef JTS2GD_ENABLE_STATS
+    if (options.stats && files.size() > 1)
+    {
+        const stats::FileStats totals = stats::totals();
+        (options.diagnostics_format == DiagnosticsFormat::TEXT ? std::cout : std::cerr)
+            << stats::table(std::to_string(totals.files) + " files", totals) << std::flush;
+    }
+
+    // (in watch mode, only the first compilation is traced)
+    if (!trace_file.empty() && !stats::write_trace(trace_file))
+        report_error(std::cerr, "could not write the trace to '" + trace_file + "'");
+#endif
+
+    if (!watch)
+    {
+        if (!success)
+            exit(1);
+        return 0;
+    }
+
+
+    //  Watch mode: the process stays alive (with everything it has already 
+    //  initialized) and recompiles only the files that are saved. Errors 
+    //  are reported but do not stop it, unless the files can no longer
+    //  be watched.
+    std::vector<std::string> watched_inputs;
+    for (auto& [input, output]: files)
+    {
+        if (input == "-")
+            panic("stdin can not be watched");
+        watched_inputs.push_back(input);
+    }
+
+    FileWatcher watcher {watched_inputs};
+    (options.diagnostics_format == DiagnosticsFormat::TEXT ? std::cout : std::cerr) << "watching " << files.size() << " file(s) for changes" << std::endl;
+
+    std::vector<uint32_t> changed;
+
+    while (true)
+    {
+        if (auto error = watcher.wait(changed))
+        {
+            report_error(std::cerr, std::string("stopped watching the files: ") + error);
+            exit(1);
+        }
+
+        for (uint32_t idx: changed)
+        {
+            stats::FileStats file_stats;
+            compile_file(files[idx].first, files[idx].second, options, std::cout, options.diagnostics_format == DiagnosticsFormat::TEXT ? std::cout : std::cerr, file_stats);
         }
     }
 }
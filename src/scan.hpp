@@ -0,0 +1,240 @@
+#ifndef JTS2GD_SCAN
+#define JTS2GD_SCAN
+
+
+// built-in
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+    #define JTS2GD_SCAN_AVX2
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define JTS2GD_SCAN_SSE2
+    #include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+
+
+//
+//  Scanning kernels
+//
+//
+//  Helpers used by the lexer to skip over long runs of uninteresting
+//  bytes (comments, string bodies, blanks, identifiers) 16 or 32 bytes
+//  at a time with SSE2/AVX2, with a scalar fallback for other targets.
+//
+//  All of them may read up to 'scan::width' bytes past 'end', so the
+//  buffer must be padded (see 'SourceBuffer'). Matches found in the
+//  padding are discarded: the result is never past 'end'.
+//
+
+
+namespace scan
+{
+
+#if defined(JTS2GD_SCAN_AVX2)
+
+    constexpr size_t width = 32;
+    using Mask = uint32_t;
+    using Block = __m256i;
+
+    inline Block load(const char* ptr)
+    {
+        return _mm256_loadu_si256((const __m256i*)ptr);
+    }
+
+    inline Mask equal(Block block, char ch)
+    {
+        return (Mask)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(ch)));
+    }
+
+    // bytes in the range [low, low + size]
+    inline Mask in_range(Block block, char low, uint8_t size)
+    {
+        Block shifted = _mm256_sub_epi8(block, _mm256_set1_epi8(low));
+        Block inside = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8((char)size)), shifted);
+        return (Mask)_mm256_movemask_epi8(inside);
+    }
+
+    // UTF-8 continuation bytes (0b10xxxxxx)
+    inline Mask continuation(Block block)
+    {
+        Block high = _mm256_and_si256(block, _mm256_set1_epi8((char)0xC0));
+        return (Mask)_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, _mm256_set1_epi8((char)0x80)));
+    }
+
+#elif defined(JTS2GD_SCAN_SSE2)
+
+    constexpr size_t width = 16;
+    using Mask = uint32_t;
+    using Block = __m128i;
+
+    inline Block load(const char* ptr)
+    {
+        return _mm_loadu_si128((const __m128i*)ptr);
+    }
+
+    inline Mask equal(Block block, char ch)
+    {
+        return (Mask)_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8(ch)));
+    }
+
+    // bytes in the range [low, low + size]
+    inline Mask in_range(Block block, char low, uint8_t size)
+    {
+        Block shifted = _mm_sub_epi8(block, _mm_set1_epi8(low));
+        Block inside = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8((char)size)), shifted);
+        return (Mask)_mm_movemask_epi8(inside);
+    }
+
+    // UTF-8 continuation bytes (0b10xxxxxx)
+    inline Mask continuation(Block block)
+    {
+        Block high = _mm_and_si128(block, _mm_set1_epi8((char)0xC0));
+        return (Mask)_mm_movemask_epi8(_mm_cmpeq_epi8(high, _mm_set1_epi8((char)0x80)));
+    }
+
+#else
+
+    // scalar fallback: a "block" is a single byte
+    constexpr size_t width = 1;
+    using Mask = uint32_t;
+    using Block = uint8_t;
+
+    inline Block load(const char* ptr)
+    {
+        return (uint8_t)*ptr;
+    }
+
+    inline Mask equal(Block block, char ch)
+    {
+        return block == (uint8_t)ch;
+    }
+
+    inline Mask in_range(Block block, char low, uint8_t size)
+    {
+        return (uint8_t)(block - (uint8_t)low) <= size;
+    }
+
+    inline Mask continuation(Block block)
+    {
+        return (block & 0xC0) == 0x80;
+    }
+
+#endif
+
+
+    inline uint32_t trailing_zeros(Mask mask)
+    {
+    #ifdef _MSC_VER
+        unsigned long idx;
+        _BitScanForward(&idx, mask);
+        return idx;
+    #else
+        return __builtin_ctz(mask);
+    #endif
+    }
+
+    inline uint32_t popcount(Mask mask)
+    {
+    #ifdef _MSC_VER
+        return __popcnt(mask);
+    #else
+        return __builtin_popcount(mask);
+    #endif
+    }
+
+    // keeps only the bits of the bytes before 'end'
+    inline Mask clip(Mask mask, const char* ptr, const char* end)
+    {
+        size_t remaining = end - ptr;
+        if (remaining < width)
+            mask &= (Mask)((1ull << remaining) - 1);
+        return mask;
+    }
+
+
+    // first occurrence of 'ch' in [ptr, end), or 'end'
+    inline const char* find(const char* ptr, const char* end, char ch)
+    {
+        for (; ptr < end; ptr += width)
+        {
+            Mask mask = clip(equal(load(ptr), ch), ptr, end);
+            if (mask)
+                return ptr + trailing_zeros(mask);
+        }
+        return end;
+    }
+
+    // first "*/" in [ptr, end), or 'end'
+    inline const char* find_comment_end(const char* ptr, const char* end)
+    {
+        for (; ptr < end; ptr += width)
+        {
+            Mask mask = equal(load(ptr), '*') & equal(load(ptr + 1), '/');
+            mask = clip(mask, ptr, end);
+            if (mask)
+                return ptr + trailing_zeros(mask);
+        }
+        return end;
+    }
+
+    // first byte that is not a blank (' ', '\t', '\n', '\v', '\f'), 'ptr' must be before the padding
+    inline const char* skip_blanks(const char* ptr)
+    {
+        while (true)
+        {
+            Block block = load(ptr);
+            Mask blanks = equal(block, ' ') | in_range(block, '\t', '\f' - '\t');
+            Mask others = ~blanks & (Mask)((1ull << width) - 1);
+
+            if (others)
+                return ptr + trailing_zeros(others);
+            ptr += width;
+        }
+    }
+
+    // first byte that can not continue an identifier, 'ptr' must be before the padding
+    inline const char* skip_identifier(const char* ptr)
+    {
+        while (true)
+        {
+            Block block = load(ptr);
+            Mask ident = in_range(block, 'a', 'z' - 'a')
+                       | in_range(block, 'A', 'Z' - 'A')
+                       | in_range(block, '0', '9' - '0')
+                       | equal(block, '_');
+            Mask others = ~ident & (Mask)((1ull << width) - 1);
+
+            if (others)
+                return ptr + trailing_zeros(others);
+            ptr += width;
+        }
+    }
+
+
+    // calls 'visit' with every occurrence of 'ch' in [ptr, end), in order
+    template <typename Visitor>
+    inline void find_each(const char* ptr, const char* end, char ch, Visitor visit)
+    {
+        for (; ptr < end; ptr += width)
+            for (Mask mask = clip(equal(load(ptr), ch), ptr, end); mask; mask &= mask - 1)
+                visit(ptr + trailing_zeros(mask));
+    }
+
+    // number of characters in [ptr, end): the bytes that are not UTF-8 continuations
+    inline uint32_t count_chars(const char* ptr, const char* end)
+    {
+        uint32_t chars = end - ptr;
+        for (; ptr < end; ptr += width)
+            chars -= popcount(clip(continuation(load(ptr)), ptr, end));
+        return chars;
+    }
+}
+
+
+#endif
@@ -0,0 +1,226 @@
+
+// built-in
+#include <cstring>
+#include <cerrno>
+#include <utility>
+#include <cstdint>
+
+#ifdef _WIN32
+    #include <io.h>
+    #include <fcntl.h>
+    #include <sys/stat.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+// local
+#include "source_buffer.hpp"
+#include "stats.hpp"
+
+
+
+#ifdef _WIN32
+
+static int open_file(const char* path)
+{
+    return _open(path, _O_RDONLY | _O_BINARY);
+}
+
+static int64_t read_file(int fd, char* buffer, size_t size)
+{
+    return _read(fd, buffer, (unsigned int)size);
+}
+
+static void close_file(int fd)
+{
+    _close(fd);
+}
+
+#else
+
+static int open_file(const char* path)
+{
+    return open(path, O_RDONLY);
+}
+
+static int64_t read_file(int fd, char* buffer, size_t size)
+{
+    return read(fd, buffer, size);
+}
+
+static void close_file(int fd)
+{
+    close(fd);
+}
+
+#endif
+
+
+
+SourceBuffer::SourceBuffer(SourceBuffer&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+SourceBuffer& SourceBuffer::operator=(SourceBuffer&& other) noexcept
+{
+    if (this != &other)
+    {
+        this->release();
+
+        this->data = std::exchange(other.data, nullptr);
+        this->size = std::exchange(other.size, 0);
+        this->mapping = std::exchange(other.mapping, nullptr);
+        this->mapping_size = std::exchange(other.mapping_size, 0);
+        this->heap = std::move(other.heap);
+    }
+
+    return *this;
+}
+
+SourceBuffer::~SourceBuffer()
+{
+    this->release();
+}
+
+
+void SourceBuffer::release()
+{
+#ifndef _WIN32
+    if (this->mapping != nullptr)
+        munmap(this->mapping, this->mapping_size);
+#endif
+
+    this->mapping = nullptr;
+    this->mapping_size = 0;
+    this->heap.reset();
+    this->data = nullptr;
+    this->size = 0;
+}
+
+
+const char* SourceBuffer::load(const std::string& path, bool allow_mapping)
+{
+    JTS2GD_STATS_PHASE(READ);
+
+    this->release();
+
+    const bool from_stdin = path == "-";
+    int fd = from_stdin ? 0 : open_file(path.c_str());
+
+    if (fd < 0)
+        return "the file is invalid or does not exist";
+
+
+#ifdef _WIN32
+    struct _stat64 info;
+    bool stat_ok = _fstat64(fd, &info) == 0;
+    bool regular = stat_ok && (info.st_mode & _S_IFREG);
+    bool directory = stat_ok && (info.st_mode & _S_IFDIR);
+#else
+    struct stat info;
+    bool stat_ok = fstat(fd, &info) == 0;
+    bool regular = stat_ok && S_ISREG(info.st_mode);
+    bool directory = stat_ok && S_ISDIR(info.st_mode);
+#endif
+
+    if (!stat_ok || directory)
+    {
+        if (!from_stdin)
+            close_file(fd);
+        return "the file is invalid or does not exist";
+    }
+
+    size_t file_size = regular ? (size_t)info.st_size : 0;
+
+
+#ifndef _WIN32
+
+    // the content can be mapped directly if the zeros that the kernel puts
+    // after the end of the file in its last page are enough for the padding
+    if (allow_mapping && regular && file_size > 0)
+    {
+        const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+        const size_t slack = (page_size - file_size % page_size) % page_size;
+
+        if (slack >= SourceBuffer::padding)
+        {
+            void* mapping = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if (mapping != MAP_FAILED)
+            {
+                madvise(mapping, file_size, MADV_SEQUENTIAL);
+                close_file(fd);
+
+                this->mapping = mapping;
+                this->mapping_size = file_size;
+                this->data = (const char*)mapping;
+                this->size = file_size;
+                return nullptr;
+            }
+        }
+    }
+
+#endif
+
+
+    bool success = this->read_stream(fd, file_size);
+
+    if (!from_stdin)
+        close_file(fd);
+
+    if (!success)
+    {
+        this->release();
+        return "could not read the file";
+    }
+
+    return nullptr;
+}
+
+
+// reads until the end of the stream into a padded heap buffer
+bool SourceBuffer::read_stream(int fd, size_t size_hint)
+{
+    size_t capacity = size_hint > 0 ? size_hint + 1 : 1 << 16;
+    size_t used = 0;
+
+    // not value-initialized, only the padding needs to be zeroed
+    auto buffer = std::unique_ptr<char[]>(new char[capacity + SourceBuffer::padding]);
+
+    while (true)
+    {
+        if (used == capacity)
+        {
+            size_t new_capacity = capacity * 2;
+            auto new_buffer = std::unique_ptr<char[]>(new char[new_capacity + SourceBuffer::padding]);
+            std::memcpy(new_buffer.get(), buffer.get(), used);
+
+            buffer = std::move(new_buffer);
+            capacity = new_capacity;
+        }
+
+        int64_t count = read_file(fd, buffer.get() + used, capacity - used);
+
+        if (count < 0 && errno == EINTR)
+            continue;
+
+        if (count < 0)
+            return false;
+
+        if (count == 0)
+            break;
+
+        used += (size_t)count;
+    }
+
+    std::memset(buffer.get() + used, 0, SourceBuffer::padding);
+
+    this->heap = std::move(buffer);
+    this->data = this->heap.get();
+    this->size = used;
+    return true;
+}
@@ -0,0 +1,78 @@
+#ifndef JTS2GD_SOURCE_BUFFER
+#define JTS2GD_SOURCE_BUFFER
+
+
+// built-in
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+
+//
+//  SourceBuffer
+//
+//
+//  Read-only content of a source file, consumed directly by the 'Lexer'
+//  (tokens point into it, so it must outlive them).
+//
+//  Regular files are memory mapped, so loading them does not copy
+//  anything. Pipes, stdin ("-") and files whose last page is too full
+//  to hold the padding are read into a heap buffer instead.
+//
+//  A mapping is only safe while nobody else truncates the file: touching
+//  a mapped page past its new end raises SIGBUS. In watch mode, editors
+//  rewrite the files while they are being compiled, so there the
+//  mapping is disabled and every file is read into the heap buffer.
+//
+//  In both cases at least 'padding' zeroed bytes are readable after
+//  the end of the content, so the lexer can look a few bytes ahead
+//  (or parse numbers with 'strtoll') without checking the bounds.
+//
+
+
+class SourceBuffer
+{
+    public:
+
+        static constexpr size_t padding = 32;
+
+    private:
+
+        const char* data = nullptr;
+        size_t size = 0;
+
+        void* mapping = nullptr; // mmap'ed region, if any
+        size_t mapping_size = 0;
+
+        std::unique_ptr<char[]> heap; // fallback storage
+
+    public:
+
+        SourceBuffer() = default;
+        SourceBuffer(SourceBuffer&&) noexcept;
+        SourceBuffer& operator=(SourceBuffer&&) noexcept;
+        ~SourceBuffer();
+
+        SourceBuffer(const SourceBuffer&) = delete;
+        SourceBuffer& operator=(const SourceBuffer&) = delete;
+
+        // loads the file ("-" for stdin), returns nullptr on success or the error message
+        const char* load(const std::string& path, bool allow_mapping = true);
+
+        std::string_view view() const
+        {
+            // an empty file still needs valid (zeroed) memory for the lexer
+            static constexpr char empty[padding] = {};
+            return this->data ? std::string_view{this->data, this->size} : std::string_view{empty, 0};
+        }
+
+    private:
+
+        void release();
+        bool read_stream(int fd, size_t size_hint);
+};
+
+
+#endif
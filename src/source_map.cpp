@@ -0,0 +1,52 @@
+
+// built-in
+#include <algorithm>
+
+// local
+#include "source_map.hpp"
+#include "scan.hpp"
+
+
+
+SourceMap::SourceMap(std::string_view source)
+: source(source)
+{
+}
+
+
+SourceMap::Position SourceMap::locate(uint32_t offset)
+{
+    if (this->line_starts.empty())
+        this->build_index();
+
+    offset = std::min<uint32_t>(offset, this->source.size());
+
+    auto next_line = std::upper_bound(this->line_starts.begin(), this->line_starts.end(), offset);
+    const uint32_t line = next_line - this->line_starts.begin();
+    const char* text = this->source.data();
+
+    Position position;
+    if (line == this->last_position.line && offset >= this->last_offset)
+        position = {line, this->last_position.collum + scan::count_chars(text + this->last_offset, text + offset)};
+    else
+        position = {line, 1 + scan::count_chars(text + *(next_line - 1), text + offset)};
+
+    this->last_offset = offset;
+    this->last_position = position;
+
+    return position;
+}
+
+
+void SourceMap::build_index()
+{
+    const char* start = this->source.data();
+    const char* end = start + this->source.size();
+
+    this->line_starts.push_back(0);
+
+    scan::find_each(start, end, '\n', [this, start](const char* newline)
+    {
+        this->line_starts.push_back(newline + 1 - start);
+    });
+}
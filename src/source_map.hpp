@@ -0,0 +1,68 @@
+#ifndef JTS2GD_SOURCE_MAP
+#define JTS2GD_SOURCE_MAP
+
+
+// built-in
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+
+//
+//  SourceMap
+//
+//
+//  Translates byte offsets of a source into lines and columns, so the
+//  lexer only has to track offsets.
+//
+//  The index of the line starts is built with a single (SIMD) scan of
+//  the source the first time a location is needed, then every lookup
+//  is a binary search. Columns count UTF-8 characters, not bytes.
+//
+//  The source must be padded (see 'SourceBuffer').
+//
+
+
+class SourceMap
+{
+    public:
+
+        struct Position
+        {
+            uint32_t line;   // from 1
+            uint32_t collum; // from 1
+        };
+
+    private:
+
+        std::string_view source;
+
+        // offsets of the first byte of every line, empty until the first 'locate'
+        std::vector<uint32_t> line_starts;
+
+        // last location resolved: locations are mostly asked in order, so the
+        // column of the next one is counted from there instead of from the
+        // start of its line (minified files are a single long line)
+        uint32_t last_offset = 0;
+        Position last_position {1, 1};
+
+    public:
+
+        SourceMap() = default;
+        explicit SourceMap(std::string_view source);
+
+        std::string_view text() const
+        {
+            return this->source;
+        }
+
+        // offsets past the end are placed at the end
+        Position locate(uint32_t offset);
+
+    private:
+
+        void build_index();
+};
+
+
+#endif
@@ -0,0 +1,321 @@
+
+// built-in
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+
+// local
+#include "stats.hpp"
+#include "tree.hpp"
+#include "utils.hpp"
+
+
+namespace stats
+{
+
+static constexpr const char* phase_names[]
+{
+    "other", "read", "lex", "parse", "codegen", "write", "release"
+};
+
+static constexpr const char* counter_names[]
+{
+    "source bytes", "tokens", "nodes", "arena blocks", "arena bytes", "rewinds", "emitted bytes", "cache hits"
+};
+
+static constexpr const char* node_kind_names[]
+{
+    "VAR_DECL", "PROGRAM", "FUNCTION_CALL_PART", "ARRAY_INDEX_PART", "MEMBER_ACCESS_PART",
+    "CONDITIONAL_EXPR", "BINARY_EXPR", "UNARY_EXPR", "PRIMARY_EXPR", "BLOCK", "VAR_DECL_STMT",
+    "IF_STMT", "WHILE_STMT", "FOR_STMT", "CONTINUE_STMT", "BREAK_STMT", "RETURN_STMT", "CASE",
+    "SWITCH_CASE_STMT", "FUNCTION_STMT", "EXPRESSION_STMT", "EMPTY_STMT", "EXTENDS_STMT",
+    "CLASS_EXTENDS_STMT", "FUNCTION_EXPRESSION"
+};
+
+static_assert(std::size(phase_names) == (size_t)Phase::COUNT);
+static_assert(std::size(counter_names) == (size_t)Counter::COUNT);
+static_assert(std::size(node_kind_names) == (size_t)NodeKind::FUNCTION_EXPRESSION + 1);
+static_assert(std::size(node_kind_names) <= max_node_kinds);
+
+
+//  Ticks and time when the process started, to convert ticks to time
+//  at the end (the longer the run, the more precise).
+struct ClockOrigin
+{
+    uint64_t ticks;
+    std::chrono::steady_clock::time_point time;
+};
+
+static const ClockOrigin origin {ticks(), std::chrono::steady_clock::now()};
+
+static std::mutex totals_mutex;
+static FileStats process_totals;
+
+static std::atomic<bool> trace_started {false};
+static uint64_t min_span_ticks = 0;
+
+// one per thread that traced a file, owned here so they outlive the threads
+static std::mutex traces_mutex;
+static std::vector<std::unique_ptr<ThreadTrace>> traces;
+
+
+
+//  Counts the blocks the arenas ask for and passes them to the default
+//  resource. Nodes are allocated inside the blocks, so this is only
+//  reached a few times per file.
+class CountingResource: public std::pmr::memory_resource
+{
+    private:
+
+        void* do_allocate(size_t bytes, size_t alignment) override
+        {
+            count(Counter::ARENA_BLOCKS, 1);
+            count(Counter::ARENA_BYTES, bytes);
+            return std::pmr::get_default_resource()->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void* ptr, size_t bytes, size_t alignment) override
+        {
+            std::pmr::get_default_resource()->deallocate(ptr, bytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+        {
+            return this == &other;
+        }
+};
+
+
+
+void FileStats::merge(const FileStats& other)
+{
+    for (size_t i = 0; i < std::size(this->ticks); i++)
+        this->ticks[i] += other.ticks[i];
+
+    for (size_t i = 0; i < std::size(this->counters); i++)
+        this->counters[i] += other.counters[i];
+
+    for (size_t i = 0; i < std::size(this->nodes); i++)
+        this->nodes[i] += other.nodes[i];
+
+    this->files += other.files;
+}
+
+
+// milliseconds per tick, measured since the start of the process
+static double ms_per_tick()
+{
+    const auto elapsed = std::chrono::steady_clock::now() - origin.time;
+    const double elapsed_ms = std::chrono::duration<double, std::milli>(elapsed).count();
+    const uint64_t elapsed_ticks = ticks() - origin.ticks;
+
+    return elapsed_ticks > 0 ? elapsed_ms / elapsed_ticks : 0;
+}
+
+
+// the trace of the calling thread, created the first time it traces a file
+static ThreadTrace* thread_trace()
+{
+    thread_local ThreadTrace* trace = nullptr;
+
+    if (trace == nullptr)
+    {
+        std::lock_guard<std::mutex> lock {traces_mutex};
+
+        traces.push_back(std::make_unique<ThreadTrace>());
+        trace = traces.back().get();
+        trace->thread = traces.size();
+        trace->min_ticks = min_span_ticks;
+    }
+
+    return trace;
+}
+
+
+
+FileRecorder::FileRecorder(FileStats& stats, const std::string& file_name)
+: start(ticks())
+{
+    stats.files = 1;
+    recording = {&stats, Phase::OTHER, this->start};
+
+    if (tracing())
+    {
+        ThreadTrace* trace = thread_trace();
+        trace->files.push_back(file_name);
+
+        recording.trace = trace;
+        recording.file = trace->files.size() - 1;
+    }
+}
+
+
+FileRecorder::~FileRecorder()
+{
+    switch_phase(Phase::OTHER);
+
+    if (recording.trace != nullptr)
+        recording.trace->spans.push_back({this->start, recording.since, recording.file, Phase::OTHER});
+
+    recording = {};
+}
+
+
+std::pmr::memory_resource* arena_upstream()
+{
+#ifdef JTS2GD_ENABLE_STATS
+    static CountingResource resource;
+    return &resource;
+#else
+    return std::pmr::get_default_resource();
+#endif
+}
+
+
+void add_to_totals(const FileStats& stats)
+{
+    std::lock_guard<std::mutex> lock {totals_mutex};
+    process_totals.merge(stats);
+}
+
+
+FileStats totals()
+{
+    std::lock_guard<std::mutex> lock {totals_mutex};
+    return process_totals;
+}
+
+
+std::string table(const std::string& title, const FileStats& stats)
+{
+    const double ms_per_tick = stats::ms_per_tick();
+
+    uint64_t total_ticks = 0;
+    for (uint64_t phase_ticks: stats.ticks)
+        total_ticks += phase_ticks;
+
+    std::string out;
+    char line[128];
+
+    auto append = [&out, &line](int size)
+    {
+        out.append(line, std::min<size_t>(size, sizeof(line) - 1));
+    };
+
+    out.append("stats of ").append(title).append("\n");
+
+    for (size_t i = 0; i < std::size(stats.ticks); i++)
+    {
+        const double share = total_ticks > 0 ? 100.0 * stats.ticks[i] / total_ticks : 0;
+        append(std::snprintf(line, sizeof(line), "  %-20s %12.3f ms %6.1f %%\n", phase_names[i], stats.ticks[i] * ms_per_tick, share));
+    }
+
+    const double total_ms = total_ticks * ms_per_tick;
+    append(std::snprintf(line, sizeof(line), "  %-20s %12.3f ms\n", "total", total_ms));
+
+    for (size_t i = 0; i < std::size(stats.counters); i++)
+        append(std::snprintf(line, sizeof(line), "  %-20s %12llu\n", counter_names[i], (unsigned long long)stats.counters[i]));
+
+    if (total_ms > 0)
+    {
+        const double seconds = total_ms / 1000;
+        append(std::snprintf(line, sizeof(line), "  %-20s %12.1f MB/s\n", "source throughput", stats.counters[(size_t)Counter::SOURCE_BYTES] / seconds / 1e6));
+        append(std::snprintf(line, sizeof(line), "  %-20s %12.0f tokens/s\n", "token throughput", stats.counters[(size_t)Counter::TOKENS] / seconds));
+    }
+
+    out.append("  nodes by kind\n");
+    for (size_t i = 0; i < std::size(node_kind_names); i++)
+        if (stats.nodes[i] > 0)
+            append(std::snprintf(line, sizeof(line), "    %-26s %8llu\n", node_kind_names[i], (unsigned long long)stats.nodes[i]));
+
+    return out;
+}
+
+
+
+void start_trace()
+{
+    // the clock is measured for a moment, to know how many ticks 'min_span' is
+    const auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(2);
+    while (std::chrono::steady_clock::now() < until);
+
+    min_span_ticks = std::chrono::duration<double, std::milli>(min_span).count() / ms_per_tick();
+    trace_started.store(true, std::memory_order_release);
+}
+
+
+bool tracing()
+{
+    return trace_started.load(std::memory_order_acquire);
+}
+
+
+//  {"displayTimeUnit":"ms","traceEvents":[
+//  {"name":"thread_name","ph":"M","pid":1,"tid":1,"args":{"name":"thread 1"}},
+//  {"name":"a.js","cat":"file","ph":"X","pid":1,"tid":1,"ts":10.5,"dur":200.1},
+//  {"name":"parse","cat":"phase","ph":"X","pid":1,"tid":1,"ts":12.5,"dur":80.2,"args":{"file":"a.js"}},
+//  ...]}
+bool write_trace(const std::string& path)
+{
+    trace_started.store(false, std::memory_order_release);
+
+    const double us_per_tick = ms_per_tick() * 1000;
+
+    std::string out {"{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"};
+    char number[64];
+
+    auto append_time = [&out, &number](const char* key, double us)
+    {
+        const int size = std::snprintf(number, sizeof(number), ",\"%s\":%.3f", key, us);
+        out.append(number, std::min<size_t>(size, sizeof(number) - 1));
+    };
+
+    std::lock_guard<std::mutex> lock {traces_mutex};
+    bool first = true;
+
+    for (auto& trace: traces)
+    {
+        const std::string tid = std::to_string(trace->thread);
+
+        out.append(first ? "" : ",\n");
+        out.append("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":").append(tid);
+        out.append(",\"args\":{\"name\":\"thread ").append(tid).append("\"}}");
+        first = false;
+
+        for (const Span& span: trace->spans)
+        {
+            const std::string& file = trace->files[span.file];
+            const bool whole_file = span.phase == Phase::OTHER;
+
+            out.append(",\n{\"name\":\"");
+            append_json(out, whole_file ? std::string_view{file} : phase_names[(size_t)span.phase]);
+            out.append(whole_file ? "\",\"cat\":\"file\"" : "\",\"cat\":\"phase\"");
+            out.append(",\"ph\":\"X\",\"pid\":1,\"tid\":").append(tid);
+            append_time("ts", (span.start - origin.ticks) * us_per_tick);
+            append_time("dur", (span.end - span.start) * us_per_tick);
+
+            if (!whole_file)
+            {
+                out.append(",\"args\":{\"file\":\"");
+                append_json(out, file);
+                out.append("\"}");
+            }
+
+            out.push_back('}');
+        }
+    }
+
+    out.append("\n]}\n");
+
+    std::ofstream file {path, std::ios::binary};
+    file.write(out.data(), out.size());
+    file.close();
+
+    return !file.fail();
+}
+
+}
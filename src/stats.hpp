@@ -0,0 +1,269 @@
+#ifndef JTS2GD_STATS
+#define JTS2GD_STATS
+
+
+// built-in
+#include <chrono>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #define JTS2GD_STATS_TSC
+    #include <x86intrin.h>
+#elif defined(_M_X64) || defined(_M_IX86)
+    #define JTS2GD_STATS_TSC
+    #include <intrin.h>
+#endif
+
+
+//
+//  Compilation statistics
+//
+//
+//  Time spent in each phase of a compilation (reading the source,
+//  lexing, parsing, generating code, writing it, releasing the tree)
+//  and counters of what it went through, shown by '--stats'.
+//
+//  The time of a thread is always accounted to a single phase: entering
+//  a phase charges the time since the last switch to the one it leaves,
+//  so nested phases are exclusive (eg, lexing on demand is not counted
+//  as parsing) and a switch reads the clock once. The clock is the TSC
+//  where there is one, converted to time with the steady clock.
+//
+//  The same phases can be traced ('--trace'): every thread keeps its
+//  own buffer of spans (a file, or a phase inside it), filled without
+//  any locking, and they are all written once at the end in the Chrome
+//  trace-event format (for Perfetto or chrome://tracing). Spans shorter
+//  than 'min_span' are not kept: the lexer and the parser alternate at
+//  every batch of tokens (see 'TokenStream'), and the shortest of those
+//  switches would outnumber the rest.
+//
+//  Nothing is recorded unless the thread is compiling a file with a
+//  'FileRecorder' alive, and the 'JTS2GD_STATS_*' macros expand to
+//  nothing when the compiler is built without 'JTS2GD_ENABLE_STATS'.
+//
+
+
+#ifdef JTS2GD_ENABLE_STATS
+    #define JTS2GD_STATS_PHASE(phase) stats::ScopedPhase stats_phase_scope {stats::Phase::phase}
+    #define JTS2GD_STATS_COUNT(counter, amount) stats::count(stats::Counter::counter, amount)
+    #define JTS2GD_STATS_NODE(kind) stats::count_node((uint32_t)(kind))
+#else
+    #define JTS2GD_STATS_PHASE(phase) ((void)0)
+    #define JTS2GD_STATS_COUNT(counter, amount) ((void)0)
+    #define JTS2GD_STATS_NODE(kind) ((void)0)
+#endif
+
+
+namespace stats
+{
+
+enum class Phase : uint8_t
+{
+    OTHER,
+    READ,
+    LEX,
+    PARSE,
+    CODEGEN,
+    WRITE,
+    RELEASE,
+
+    COUNT
+};
+
+enum class Counter : uint8_t
+{
+    SOURCE_BYTES,
+    TOKENS,
+    NODES,
+    ARENA_BLOCKS,  // allocations made by the arena of the tree
+    ARENA_BYTES,
+    REWINDS,       // statements skipped by the parser to recover from an error
+    EMITTED_BYTES,
+    CACHE_HITS,
+
+    COUNT
+};
+
+// room for every 'NodeKind'
+static constexpr uint32_t max_node_kinds = 32;
+
+
+struct FileStats
+{
+    uint64_t ticks[(size_t)Phase::COUNT] {};
+    uint64_t counters[(size_t)Counter::COUNT] {};
+    uint64_t nodes[max_node_kinds] {};
+    uint32_t files = 0;
+
+    void merge(const FileStats& other);
+};
+
+
+inline uint64_t ticks()
+{
+#ifdef JTS2GD_STATS_TSC
+    return __rdtsc();
+#else
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+
+static constexpr std::chrono::microseconds min_span {20};
+
+
+struct Span
+{
+    uint64_t start;
+    uint64_t end;
+    uint32_t file;  // in the 'files' of its thread
+    Phase phase;    // 'OTHER' for the whole file
+};
+
+
+//  Spans of a thread. Only touched by its thread until the trace is written.
+struct ThreadTrace
+{
+    uint32_t thread;
+    uint64_t min_ticks;
+    std::vector<std::string> files;
+    std::vector<Span> spans;
+};
+
+
+//  What the thread is recording: the stats of the file it compiles (if
+//  any), the phase it is in and when it entered it, and where its spans
+//  go when tracing.
+struct Recording
+{
+    FileStats* stats = nullptr;
+    Phase phase = Phase::OTHER;
+    uint64_t since = 0;
+
+    ThreadTrace* trace = nullptr;
+    uint32_t file = 0;
+};
+
+inline thread_local Recording recording;
+
+
+// charges the time until now to the current phase and switches to 'phase', returns the one it left
+inline Phase switch_phase(Phase phase)
+{
+    Recording& current = recording;
+    const uint64_t now = ticks();
+
+    current.stats->ticks[(size_t)current.phase] += now - current.since;
+    current.since = now;
+
+    const Phase previous = current.phase;
+    current.phase = phase;
+    return previous;
+}
+
+
+inline void trace_span(Phase phase, uint64_t start, uint64_t end)
+{
+    ThreadTrace* trace = recording.trace;
+
+    if (trace != nullptr && end - start >= trace->min_ticks)
+        trace->spans.push_back({start, end, recording.file, phase});
+}
+
+
+class ScopedPhase
+{
+    private:
+
+        bool active;
+        Phase phase;
+        Phase previous = Phase::OTHER;
+        uint64_t start = 0;
+
+    public:
+
+        explicit ScopedPhase(Phase phase)
+        : active(recording.stats != nullptr), phase(phase)
+        {
+            if (this->active)
+            {
+                this->previous = switch_phase(phase);
+                this->start = recording.since;
+            }
+        }
+
+        ~ScopedPhase()
+        {
+            if (this->active)
+            {
+                switch_phase(this->previous);
+                trace_span(this->phase, this->start, recording.since);
+            }
+        }
+
+        ScopedPhase(const ScopedPhase&) = delete;
+        ScopedPhase& operator=(const ScopedPhase&) = delete;
+};
+
+
+inline void count(Counter counter, uint64_t amount)
+{
+    if (recording.stats != nullptr)
+        recording.stats->counters[(size_t)counter] += amount;
+}
+
+inline void count_node(uint32_t kind)
+{
+    if (recording.stats != nullptr)
+    {
+        recording.stats->nodes[kind]++;
+        recording.stats->counters[(size_t)Counter::NODES]++;
+    }
+}
+
+
+//  Records the stats of the file the thread compiles while it is alive
+//  (the whole time is charged to the file, 'OTHER' if in no phase), and
+//  its spans if the trace is started.
+class FileRecorder
+{
+    private:
+
+        uint64_t start;
+
+    public:
+
+        FileRecorder(FileStats& stats, const std::string& file_name);
+        ~FileRecorder();
+
+        FileRecorder(const FileRecorder&) = delete;
+        FileRecorder& operator=(const FileRecorder&) = delete;
+};
+
+
+// upstream of the arenas of the trees, counts their allocations (when stats are built in)
+std::pmr::memory_resource* arena_upstream();
+
+// adds the stats of a file to the totals of the process (from any thread)
+void add_to_totals(const FileStats& stats);
+
+FileStats totals();
+
+// human readable table of 'stats'
+std::string table(const std::string& title, const FileStats& stats);
+
+// makes the next 'FileRecorder's trace their files (call before starting them)
+void start_trace();
+
+bool tracing();
+
+// writes the spans of every thread to 'path', once no thread records them anymore; false on failure
+bool write_trace(const std::string& path);
+
+}
+
+
+#endif
@@ -0,0 +1,138 @@
+
+// built-in
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// local
+#include "symbol_table.hpp"
+#include "utils.hpp"
+
+
+
+// names are indexed in chunks, so interning one never moves the others
+static constexpr uint32_t chunk_size = 4096;
+static constexpr size_t text_block_size = 64 * 1024;
+
+static constexpr uint32_t shard_count = 64;
+static constexpr uint32_t recent_size = 4096; // entries of the per-thread cache
+
+
+//  A part of the table, chosen by the hash of the name. Threads interning
+//  names of different shards never wait for each other.
+struct Shard
+{
+    std::mutex mutex;
+    std::unordered_map<std::string_view, Symbol> symbols; // keys point into 'text_blocks'
+
+    std::vector<std::unique_ptr<char[]>> text_blocks;
+    size_t text_block_used = text_block_size;
+
+    // copies a name in the text blocks of the shard (its lock must be held)
+    std::string_view store_text(std::string_view name)
+    {
+        if (name.size() > text_block_size)
+        {
+            this->text_blocks.push_back(std::make_unique<char[]>(name.size()));
+            std::memcpy(this->text_blocks.back().get(), name.data(), name.size());
+            return {this->text_blocks.back().get(), name.size()};
+        }
+
+        if (this->text_block_used + name.size() > text_block_size)
+        {
+            this->text_blocks.push_back(std::make_unique<char[]>(text_block_size));
+            this->text_block_used = 0;
+        }
+
+        char* text = this->text_blocks.back().get() + this->text_block_used;
+        std::memcpy(text, name.data(), name.size());
+        this->text_block_used += name.size();
+
+        return {text, name.size()};
+    }
+};
+
+
+//  Symbols interned recently by the thread, by hash. Most identifiers
+//  repeat a lot, so most lookups end here without taking any lock.
+struct RecentSymbol
+{
+    size_t hash = 0;
+    Symbol symbol = SymbolTable::none;
+};
+
+
+static Shard shards[shard_count];
+static std::atomic<std::string_view*> chunks[SymbolTable::max_symbols / chunk_size];
+static std::atomic<uint32_t> symbol_count {0};
+
+
+
+// the chunk that holds the name of 'symbol', created by the first thread that needs it
+static std::string_view* chunk_of(Symbol symbol)
+{
+    std::atomic<std::string_view*>& slot = chunks[symbol / chunk_size];
+    std::string_view* chunk = slot.load(std::memory_order_acquire);
+
+    if (chunk == nullptr)
+    {
+        auto created = std::make_unique<std::string_view[]>(chunk_size);
+
+        if (slot.compare_exchange_strong(chunk, created.get(), std::memory_order_acq_rel))
+            chunk = created.release();
+    }
+
+    return chunk;
+}
+
+
+Symbol SymbolTable::intern(std::string_view name)
+{
+    thread_local RecentSymbol recent[recent_size];
+
+    const size_t hash = std::hash<std::string_view>{}(name);
+    RecentSymbol& cached = recent[hash % recent_size];
+
+    if (cached.hash == hash && cached.symbol != none && SymbolTable::name(cached.symbol) == name)
+        return cached.symbol;
+
+    Shard& shard = shards[(hash >> 32) % shard_count];
+    Symbol symbol;
+    {
+        std::lock_guard<std::mutex> lock {shard.mutex};
+
+        auto found = shard.symbols.find(name);
+        if (found != shard.symbols.end())
+            symbol = found->second;
+        else
+        {
+            symbol = symbol_count.fetch_add(1, std::memory_order_relaxed);
+            if (symbol >= max_symbols)
+                panic("too many identifiers");
+
+            // other threads only see the symbol through this shard, after the name is set
+            const std::string_view text = shard.store_text(name);
+            chunk_of(symbol)[symbol % chunk_size] = text;
+            shard.symbols.emplace(text, symbol);
+        }
+    }
+
+    cached = {hash, symbol};
+    return symbol;
+}
+
+
+std::string_view SymbolTable::name(Symbol symbol)
+{
+    return chunks[symbol / chunk_size].load(std::memory_order_acquire)[symbol % chunk_size];
+}
+
+
+uint32_t SymbolTable::count()
+{
+    return symbol_count.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,49 @@
+#ifndef JTS2GD_SYMBOL_TABLE
+#define JTS2GD_SYMBOL_TABLE
+
+
+// built-in
+#include <cstdint>
+#include <string_view>
+
+
+//
+//  SymbolTable
+//
+//
+//  Interns the identifiers met by the lexer, so the later passes compare
+//  and look up names as 32-bit ids (eg, the scopes of the code generator
+//  are arrays indexed by symbol) instead of hashing strings.
+//
+//  The table is shared by every file compiled by the process, so the
+//  parallel compilation of a batch assigns the same ids to the same
+//  names. It is split in shards by the hash of the name, each with its
+//  own lock, and every thread keeps a small cache of the symbols it
+//  interned recently, so repeated identifiers do not lock at all.
+//
+//  Interned names are copied into the table and never move, so 'name'
+//  needs no locking: a symbol is only known by the threads it was
+//  handed to.
+//
+
+
+using Symbol = uint32_t;
+
+
+class SymbolTable
+{
+    public:
+
+        static constexpr Symbol none = UINT32_MAX;
+        static constexpr uint32_t max_symbols = 1 << 24;
+
+        static Symbol intern(std::string_view name);
+
+        static std::string_view name(Symbol symbol);
+
+        // upper bound of the symbols interned so far (to size tables indexed by symbol)
+        static uint32_t count();
+};
+
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef JTS2GD_TOKEN_STREAM
+#define JTS2GD_TOKEN_STREAM
+
+
+// built-in
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// local
+#include "globals.hpp"
+#include "lexer.hpp"
+#include "stats.hpp"
+
+
+//
+//  TokenStream
+//
+//
+//  Feeds the parser with tokens lexed on demand, so the whole
+//  sequence of tokens never needs to be in memory at once.
+//
+//  The tokens live in a ring buffer that only holds the window the
+//  parser can still look at: 'lookbehind' tokens before the current
+//  one and 'lookahead' tokens after it. 'peek_ahead' can look further
+//  (eg, to find the end of a parenthesized group), in which case every
+//  token until there is kept and the ring grows if needed.
+//
+//  Tokens are lexed in batches of 'refill' (or up to the token asked
+//  for, if it is further), so the work of the lexer is timed once per
+//  batch with '--stats' instead of around every token.
+//
+//  References returned by 'peek' are valid until the next 'advance'
+//  or 'peek_ahead'. Tokens that must outlive that (eg, stored in the
+//  tree) have to be copied.
+//
+
+
+class TokenStream
+{
+    public:
+
+        static constexpr uint32_t lookbehind = 1;
+        static constexpr uint32_t lookahead = 1;
+        static constexpr uint32_t refill = 1024; // tokens lexed at once (tens of microseconds of lexing)
+
+    private:
+
+        Lexer& lexer;
+        std::ostream* echo; // if not null, every token lexed is printed on it
+
+        std::vector<Token> ring; // the size is always a power of two
+        uint64_t head = 0;       // absolute position of the current token
+        uint64_t end = 0;        // absolute position after the last token lexed
+        bool finished = false;   // the EOF token has been lexed
+
+    public:
+
+        explicit TokenStream(Lexer& lexer, std::ostream* echo = nullptr, uint32_t capacity = 2 * refill)
+        : lexer(lexer), echo(echo)
+        {
+            uint32_t size = 4; // room for the look-behind, current and look-ahead tokens
+            while (size < capacity)
+                size *= 2;
+
+            this->ring.resize(size);
+            this->fill(lookahead);
+        }
+
+        TokenStream(const TokenStream&) = delete;
+        TokenStream& operator=(const TokenStream&) = delete;
+
+        // offsets in [-lookbehind, lookahead], the EOF token repeats after the end
+        // (before the first token there is nothing to look behind, it is returned instead)
+        const Token& peek(int offset = 0) const
+        {
+            assert(offset >= -(int)lookbehind);
+
+            uint64_t pos;
+            if (offset < 0)
+                pos = this->head >= (uint64_t)-offset ? this->head - (uint64_t)-offset : 0;
+            else
+                pos = std::min(this->head + (uint64_t)offset, this->end - 1);
+
+            return this->ring[pos & (this->ring.size() - 1)];
+        }
+
+        void advance(uint32_t count = 1)
+        {
+            this->head += count;
+
+            if (this->finished)
+                this->head = std::min(this->head, this->end - 1);
+            else
+                this->fill(this->head + lookahead);
+        }
+
+        // like 'peek', but with any offset ahead of the current token
+        const Token& peek_ahead(uint32_t offset)
+        {
+            this->fill(this->head + offset);
+            return this->peek(offset);
+        }
+
+        // absolute position of the current token, counting from the start of the source
+        uint64_t position() const
+        {
+            return this->head;
+        }
+
+        size_t source_bytes() const
+        {
+            return this->lexer.source_bytes();
+        }
+
+    private:
+
+        // lexes until the token at 'target' (or EOF), and at least a batch of 'refill' tokens
+        void fill(uint64_t target)
+        {
+            if (this->finished || this->end > target)
+                return;
+
+            JTS2GD_STATS_PHASE(LEX);
+
+            [[maybe_unused]] const uint64_t start = this->end;
+            target = std::max(target, this->end + refill - 1);
+
+            while (!this->finished && this->end <= target)
+            {
+                uint64_t oldest = this->head > lookbehind ? this->head - lookbehind : 0;
+
+                if (this->end - oldest >= this->ring.size())
+                    this->grow(oldest);
+
+                Token& tk = this->ring[this->end & (this->ring.size() - 1)];
+                tk = this->lexer.next();
+                ++this->end;
+
+                if (this->echo != nullptr)
+                    *this->echo << tk.repr() << '\n';
+
+                if (tk.type == TokenType::lEOF)
+                    this->finished = true;
+            }
+
+            JTS2GD_STATS_COUNT(TOKENS, this->end - start);
+        }
+
+        // doubles the ring, moving the tokens still in use to their new slots
+        void grow(uint64_t oldest)
+        {
+            std::vector<Token> bigger (this->ring.size() * 2);
+
+            for (uint64_t pos = oldest; pos < this->end; ++pos)
+                bigger[pos & (bigger.size() - 1)] = this->ring[pos & (this->ring.size() - 1)];
+
+            this->ring = std::move(bigger);
+        }
+};
+
+
+#endif
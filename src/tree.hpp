@@ -5,9 +5,14 @@
 // built-in
 #include <vector>
 #include <cstdint>
+#include <cstddef>
+#include <memory_resource>
+#include <type_traits>
+#include <new>
 
 // local
 #include "globals.hpp"
+#include "stats.hpp"
 
 
 
@@ -67,12 +72,59 @@ struct Visitor
     virtual void visit(FunctionExpression&) = 0;
 };
 
+//  Concrete type of a node, to classify nodes without RTTI
+enum class NodeKind : uint8_t
+{
+    VAR_DECL,
+    PROGRAM,
+    FUNCTION_CALL_PART,
+    ARRAY_INDEX_PART,
+    MEMBER_ACCESS_PART,
+    CONDITIONAL_EXPR,
+    BINARY_EXPR,
+    UNARY_EXPR,
+    PRIMARY_EXPR,
+    BLOCK,
+    VAR_DECL_STMT,
+    IF_STMT,
+    WHILE_STMT,
+    FOR_STMT,
+    CONTINUE_STMT,
+    BREAK_STMT,
+    RETURN_STMT,
+    CASE,
+    SWITCH_CASE_STMT,
+    FUNCTION_STMT,
+    EXPRESSION_STMT,
+    EMPTY_STMT,
+    EXTENDS_STMT,
+    CLASS_EXTENDS_STMT,
+    FUNCTION_EXPRESSION
+};
+
 struct Element
 {
+    const NodeKind kind;
+
+    explicit Element(NodeKind kind)
+    : kind(kind)
+    {
+
+    }
+
     virtual void accept(Visitor&) = 0;
 };
 
 
+//  All nodes (and the lists inside them) are allocated in the 
+//  arena of the 'Program' they belong to. Nodes that own lists 
+//  receive the arena allocator in their constructor.
+using NodeAllocator = std::pmr::polymorphic_allocator<std::byte>;
+
+template <typename T>
+using NodeList = std::pmr::vector<T>;
+
+
 
 
 
@@ -82,18 +134,21 @@ struct Element
 class Statement: public Element
 {
     public:
+        using Element::Element;
         virtual ~Statement() = default;
 };
 
 class Expression: public Element
 {
     public:
+        using Element::Element;
         virtual ~Expression() = default;
 };
 
 
 struct MemberExprPart: public Element
 {
+    using Element::Element;
     virtual ~MemberExprPart() = default;
 };
 
@@ -104,9 +159,14 @@ struct VarDecl: public Element
     const Token* type = nullptr;      // nullptr if no type has been specified
     Expression* init_value = nullptr; // nullptr if there is no initialization expression
 
-    VarDecl() = default;
+    VarDecl()
+    : Element(NodeKind::VAR_DECL)
+    {
+
+    }
 
     VarDecl(VarDecl&& other)
+    : Element(NodeKind::VAR_DECL)
     {
         this->var = other.var;
         this->type = other.type;
@@ -125,10 +185,63 @@ struct VarDecl: public Element
 
 
 
+//
+//  Program
+//
+//
+//  Root of the tree and owner of the arena where all its nodes live.
+//
+//  Nodes are never destroyed one by one: every list inside them 
+//  uses the arena too, so deleting the 'Program' releases the whole 
+//  tree at once (see 'release_program').
+//
 struct Program: public Element
 {
-    std::vector<Statement*> stmts;
-    std::vector<FunctionExpression*> function_expressions;
+    std::pmr::monotonic_buffer_resource arena;
+
+    NodeList<Statement*> stmts;
+    NodeList<FunctionExpression*> function_expressions;
+
+    explicit Program(size_t arena_size = 4096)
+    : Element(NodeKind::PROGRAM), arena(arena_size, stats::arena_upstream()), stmts(&this->arena), function_expressions(&this->arena)
+    {
+
+    }
+
+    Program(const Program&) = delete;
+    Program& operator=(const Program&) = delete;
+
+    // creates a node inside the arena
+    template <typename T>
+    T* make()
+    {
+        static_assert(std::is_base_of_v<Element, T>);
+        void* memory = this->arena.allocate(sizeof(T), alignof(T));
+
+        T* node;
+        if constexpr (std::is_constructible_v<T, NodeAllocator>)
+            node = new (memory) T(NodeAllocator{&this->arena});
+        else
+            node = new (memory) T{};
+
+        JTS2GD_STATS_NODE(node->kind);
+        return node;
+    }
+
+    // creates a list inside the arena (eg, members of an array literal)
+    template <typename T>
+    NodeList<T>* make_list()
+    {
+        void* memory = this->arena.allocate(sizeof(NodeList<T>), alignof(NodeList<T>));
+        return new (memory) NodeList<T>(&this->arena);
+    }
+
+    // copies a token inside the arena, so the tree does not depend on the lexer output
+    const Token* copy_token(const Token& tk)
+    {
+        void* memory = this->arena.allocate(sizeof(Token), alignof(Token));
+        return new (memory) Token(tk);
+    }
 
     void accept(Visitor& v) override
     {
@@ -149,7 +262,13 @@ struct Program: public Element
 
 struct FunctionCallPart: public MemberExprPart
 {
-    std::vector<Expression*> args;
+    NodeList<Expression*> args;
+
+    explicit FunctionCallPart(NodeAllocator alloc)
+    : MemberExprPart(NodeKind::FUNCTION_CALL_PART), args(alloc)
+    {
+
+    }
 
     void accept(Visitor& v) override
     {
@@ -161,6 +280,12 @@ struct MemberAccessPart: public MemberExprPart
 {
     const Token* member;
 
+    MemberAccessPart()
+    : MemberExprPart(NodeKind::MEMBER_ACCESS_PART)
+    {
+
+    }
+
     void accept(Visitor& v) override
     {
         v.visit(*this);
@@ -171,6 +296,12 @@ struct ArrayIndexPart: public MemberExprPart
 {
     Expression* index = nullptr;
 
+    ArrayIndexPart()
+    : MemberExprPart(NodeKind::ARRAY_INDEX_PART)
+    {
+
+    }
+
     void accept(Visitor& v) override
     {
         v.visit(*this);
@@ -193,6 +324,12 @@ struct ConditionalExpr: public Expression
     Expression* expr1 = nullptr;
     Expression* expr2 = nullptr;
 
+    ConditionalExpr()
+    : Expression(NodeKind::CONDITIONAL_EXPR)
+    {
+
+    }
+
     void accept(Visitor& v) override
     {
         v.visit(*this);
@@ -205,6 +342,12 @@ struct BinaryExpr: public Expression
     Expression* left = nullptr;
     Expression* right = nullptr;
 
+    BinaryExpr()
+    : Expression(NodeKind::BINARY_EXPR)
+    {
+
+    }
+
     void accept(Visitor& v) override
     {
         v.visit(*this);
@@ -216,6 +359,12 @@ struct UnaryExpr: public Expression
     const Token* oprt;
     Expression* value = nullptr;
 
+    UnaryExpr()
+    : Expression(NodeKind::UNARY_EXPR)
+    {
+
+    }
+
     void accept(Visitor& v) override
     {
         v.visit(*this);
@@ -237,11 +386,17 @@ struct PrimaryExpr: public Expression
         const Token* identifier = nullptr;
         const Token* literal;
         Expression* expr;
-        std::vector<Expression*>* array_members;
+        NodeList<Expression*>* array_members;
     };
 
     PrimaryExprType type;
-    std::vector<MemberExprPart*> parts;
+    NodeList<MemberExprPart*> parts;
+
+    explicit PrimaryExpr(NodeAllocator alloc)
+    : Expression(NodeKind::PRIMARY_EXPR), parts(alloc)
+    {
+
+    }
 
     void accept(Visitor& v) override
     {
@@ -259,7 +414,13 @@ struct PrimaryExpr: public Expression
 
 struct Block: public Statement
 {
-    std::vector<Statement*> stmts;
+    NodeList<Statement*> stmts;
+
+    explicit Block(NodeAllocator alloc)
+    : Statement(NodeKind::BLOCK), stmts(alloc)
+    {
+
+    }
 
     void accept(Visitor& v) override
     {
@@ -282,9 +443,15 @@ inline const char* VarDeclStmtTypeRepr[]
 
 struct VarDeclStmt: public Statement
 {
-    std::vector<VarDecl*> decls;
+    NodeList<VarDecl*> decls;
     VarDeclStmtType type;
 
+    explicit VarDeclStmt(NodeAllocator alloc)
+    : Statement(NodeKind::VAR_DECL_STMT), decls(alloc)
+    {
+
+    }
+
     void accept(Visitor& v) override
     {
         v.visit(*this);
@@ -297,6 +464,12 @@ struct IfStmt: public Statement
     Statement* body = nullptr;
     Statement* else_block = nullptr; // nullptr if not used
 
+    IfStmt()
+    : Statement(NodeKind::IF_STMT)
+    {
+
+    }
+
     void accept(Visitor& v) override
     {
         v.visit(*this);
@@ -308,6 +481,12 @@ struct WhileStmt: public Statement
     Expression* cond = nullptr;
     Statement* body = nullptr;
 
+    WhileStmt()
+    : Statement(NodeKind::WHILE_STMT)
+    {
+
+    }
+
     void accept(Visitor& v) override
     {
         v.visit(*this);
@@ -328,6 +507,12 @@ struct ForStmt: public Statement
     Expression* post = nullptr; // nullptr if not used
     Statement* block = nullptr;
 
+    ForStmt()
+    : Statement(NodeKind::FOR_STMT)
+    {
+
+    }
+
     void accept(Visitor& v) override
     {
         v.visit(*this);
@@ -337,6 +522,12 @@ struct ForStmt: public Statement
 
 struct ContinueStmt: public Statement
 {
+    ContinueStmt()
+    : Statement(NodeKind::CONTINUE_STMT)
+    {
+
+    }
+
     void accept(Visitor& v) override
     {
         v.visit(*this);
@@ -344,6 +535,12 @@ struct ContinueStmt: public Statement
 };
 struct BreakStmt: public Statement
 {
+    BreakStmt()
+    : Statement(NodeKind::BREAK_STMT)
+    {
+
+    }
+
     void accept(Visitor& v) override
     {
         v.visit(*this);
@@ -354,6 +551,12 @@ struct ReturnStmt: public Statement
 
     Expression* value = nullptr; // nullptr case has no return value
 
+    ReturnStmt()
+    : Statement(NodeKind::RETURN_STMT)
+    {
+
+    }
+
     void accept(Visitor& v) override
     {
         v.visit(*this);
@@ -362,8 +565,14 @@ struct ReturnStmt: public Statement
 
 struct Case: public Element
 {
-    std::vector<Expression*> comp_values; // nullptr if default clause
-    std::vector<Statement*> stmts;
+    NodeList<Expression*> comp_values; // nullptr if default clause
+    NodeList<Statement*> stmts;
+
+    explicit Case(NodeAllocator alloc)
+    : Element(NodeKind::CASE), comp_values(alloc), stmts(alloc)
+    {
+
+    }
 
     void accept(Visitor& v) override
     {
@@ -377,7 +586,13 @@ struct SwitchCaseStmt: public Statement
 {
 
     Expression* match_value = nullptr;
-    std::vector<Case*> case_clauses;
+    NodeList<Case*> case_clauses;
+
+    explicit SwitchCaseStmt(NodeAllocator alloc)
+    : Statement(NodeKind::SWITCH_CASE_STMT), case_clauses(alloc)
+    {
+
+    }
 
     void accept(Visitor& v) override
     {
@@ -388,10 +603,16 @@ struct SwitchCaseStmt: public Statement
 
 struct FunctionStmt: public Statement
 {
-    const Token* name;
-    std::vector<VarDecl*> params;      // nullptr if it has no parameters
-    const Token* type;                 // nullptr if no type has been specified
-    std::vector<Statement*> func_body;
+    const Token* name = nullptr;
+    NodeList<VarDecl*> params;         // nullptr if it has no parameters
+    const Token* type = nullptr;       // nullptr if no type has been specified
+    NodeList<Statement*> func_body;
+
+    explicit FunctionStmt(NodeAllocator alloc)
+    : Statement(NodeKind::FUNCTION_STMT), params(alloc), func_body(alloc)
+    {
+
+    }
 
     void accept(Visitor& v) override
     {
@@ -403,6 +624,12 @@ struct ExpressionStmt: Statement
 {
     Expression* expr = nullptr;
 
+    ExpressionStmt()
+    : Statement(NodeKind::EXPRESSION_STMT)
+    {
+
+    }
+
     void accept(Visitor& v) override
     {
         v.visit(*this);
@@ -411,6 +638,12 @@ struct ExpressionStmt: Statement
 
 struct EmptyStmt: public Statement
 {
+    EmptyStmt()
+    : Statement(NodeKind::EMPTY_STMT)
+    {
+
+    }
+
     void accept(Visitor& v) override
     {
         v.visit(*this);
@@ -421,6 +654,12 @@ struct ExtendsStmt: public Statement
 {
     const Token* name;
 
+    ExtendsStmt()
+    : Statement(NodeKind::EXTENDS_STMT)
+    {
+
+    }
+
     void accept(Visitor& v) override
     {
         v.visit(*this);
@@ -429,10 +668,16 @@ struct ExtendsStmt: public Statement
 
 struct ClassExtendsStmt: public Statement
 {
-    const Token* class_name; // useless for now
-    const Token* extended;
+    const Token* class_name = nullptr; // useless for now
+    const Token* extended = nullptr;
 
-    std::vector<Statement*> body;
+    NodeList<Statement*> body;
+
+    explicit ClassExtendsStmt(NodeAllocator alloc)
+    : Statement(NodeKind::CLASS_EXTENDS_STMT), body(alloc)
+    {
+
+    }
 
     void accept(Visitor& v) override
     {
@@ -444,13 +689,17 @@ struct FunctionExpression: Element
 {
     Token name;
     Token literal;
-    std::string name_value;
-    std::string literal_value;
-    std::vector<VarDecl*> params;      // nullptr if it has no parameters
+    NodeList<VarDecl*> params;         // nullptr if it has no parameters
     
     bool expression_body = false;
     Expression* expression = nullptr;
-    std::vector<Statement*> func_body; 
+    NodeList<Statement*> func_body; 
+
+    explicit FunctionExpression(NodeAllocator alloc)
+    : Element(NodeKind::FUNCTION_EXPRESSION), params(alloc), func_body(alloc)
+    {
+
+    }
 
     void accept(Visitor& v) override
     {
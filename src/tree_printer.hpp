@@ -54,12 +54,12 @@ struct Printer: public Visitor
 
     void visit(VarDecl& vdecl) override
     {
-        this->output.append(vdecl.var->lexeme);
+        this->output.append(vdecl.var->lexeme());
 
         if (vdecl.type)
         {
             this->output.append(": ");
-            this->output.append(vdecl.type->lexeme);
+            this->output.append(vdecl.type->lexeme());
         }
 
         if (vdecl.init_value)
@@ -125,7 +125,7 @@ struct Printer: public Visitor
     void visit(MemberAccessPart& maccess) override
     {
         this->output.push_back('.');
-        this->output.append(maccess.member->lexeme);
+        this->output.append(maccess.member->lexeme());
     }
 
     void visit(ConditionalExpr& cexpr) override
@@ -146,7 +146,7 @@ struct Printer: public Visitor
         this->indent_stack.push(false);
         this->visit(bexpr.left);
         this->output.push_back(' ');
-        this->output.append(bexpr.oprt->lexeme);
+        this->output.append(bexpr.oprt->lexeme());
         this->output.push_back(' ');
         this->visit(bexpr.right);
         this->indent_stack.pop();
@@ -155,7 +155,7 @@ struct Printer: public Visitor
     void visit(UnaryExpr& uexpr) override
     {
         this->indent_stack.push(false);
-        this->output.append(uexpr.oprt->lexeme);
+        this->output.append(uexpr.oprt->lexeme());
         this->visit(uexpr.value);
         this->indent_stack.pop();
     }
@@ -168,12 +168,12 @@ struct Printer: public Visitor
         {
             case (PrimaryExprType::IDENTIFIER):
             {
-                this->output.append(pexpr.identifier->lexeme);
+                this->output.append(pexpr.identifier->lexeme());
                 break;
             }
             case (PrimaryExprType::LITERAL):
             {
-                this->output.append(pexpr.literal->lexeme);
+                this->output.append(pexpr.literal->lexeme());
                 break;
             }
             case (PrimaryExprType::EXPRESSION):
@@ -309,7 +309,7 @@ struct Printer: public Visitor
 
         if (fstmt.for_of)
         {
-            this->output.append(fstmt.init_var_decl->lexeme);
+            this->output.append(fstmt.init_var_decl->lexeme());
             this->output.append(" of ");
             this->visit(fstmt.of_expr);
         }
@@ -437,7 +437,7 @@ struct Printer: public Visitor
             this->indent();
 
         this->output.append("function ");
-        this->output.append(fdecl.name->lexeme);
+        this->output.append(fdecl.name->lexeme());
         this->output.push_back('(');
 
         this->indent_stack.push(false);
@@ -460,7 +460,7 @@ struct Printer: public Visitor
         if (fdecl.type != nullptr)
         {
             this->output.append(": ");
-            this->output.append(fdecl.type->lexeme);
+            this->output.append(fdecl.type->lexeme());
         }
 
         this->line_feed();
@@ -503,7 +503,7 @@ struct Printer: public Visitor
             this->indent();
             
         this->output.append("extends ");
-        this->output.append(estmt.name->lexeme);
+        this->output.append(estmt.name->lexeme());
     }
 
     void visit(ClassExtendsStmt& cestmt) override
@@ -512,7 +512,7 @@ struct Printer: public Visitor
             this->indent();
 
         this->output.append("class ");
-        this->output.append(cestmt.class_name->lexeme);
+        this->output.append(cestmt.class_name->lexeme());
         this->output.append(" extends");
 
         this->line_feed();
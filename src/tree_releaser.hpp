@@ -3,66 +3,23 @@
 
 
 // built-in
-#include <functional>
-#include <type_traits>
-#include <utility>
 #include <cstdint>
 
 // local
 #include "tree.hpp"
-#include "tree_traverse.hpp"
-
-
-// Implementation of a Traverser to free the memory 
-// of all nodes in the tree (after freeing all its child nodes)
-struct ReleaserTraverserBase: public TraverserBase<ReleaserTraverserBase>
-{
-    template <typename T, typename = std::enable_if_t<std::is_base_of_v<Element, T>>>
-    inline void pre(T*)
-    {
-
-    }
-
-    template <typename T, typename = std::enable_if_t<std::is_base_of_v<Element, T>>>
-    inline void post(T* element)
-    {
-        delete element;
-    }
-};
-
-
-//  Specialization of the Releaser to guarantee 
-//  the deletion of the pointer to the array member 
-//  vector (if it exists) of a 'PrimaryExpr'
-template <>
-inline void ReleaserTraverserBase::post<PrimaryExpr>(PrimaryExpr* pexpr)
-{
-    if (pexpr->type == PrimaryExprType::ARRAY_LITERAL)
-        delete pexpr->array_members;
-    delete pexpr;
-}
-
-
-using Releaser = Traverser<ReleaserTraverserBase>;
-
+#include "stats.hpp"
 
 
+//  Frees the whole tree.
+//
+//  Every node lives in the arena owned by the 'Program', 
+//  so there is no need to visit the tree: destroying the 
+//  program releases all the memory of the arena at once.
 inline void release_program(Program* prog)
 {
-    Releaser().visit(prog);
+    JTS2GD_STATS_PHASE(RELEASE);
+    delete prog;
 }
 
 
-//  Functor to create a specific instantiation 
-//  of 'unique_ptr' to ensure that the tree nodes 
-//  are released correctly in the event of a syntax error.
-template <typename T>
-struct UniqueReleaser
-{
-    void operator()(T* ptr)
-    {
-        Releaser().visit(ptr);
-    }
-};
-
-#endif
\ No newline at end of file
+#endif
@@ -7,6 +7,8 @@
 #include <sstream>
 #include <iostream>
 #include <cstdint>
+#include <string>
+#include <string_view>
 
 
 struct SourceLocation
@@ -15,6 +17,10 @@ struct SourceLocation
     uint32_t line;
     uint32_t collum;
 
+    uint32_t offset = 0; // in bytes, from the start of the file
+    uint32_t size = 0;   // in bytes, of the code it points to (0 if unknown)
+    uint16_t file = 0;   // id in the 'FileTable'
+
     template <class STREAM>
     friend STREAM& operator<<(STREAM& stream, const SourceLocation& sl)
     {
@@ -63,14 +69,47 @@ inline std::string get_color(Color md)
     #endif
 }
 
+// reports a fatal error without leaving the program (eg, inside a compilation job)
+inline void report_error(std::ostream& stream, const std::string& msg)
+{
+    stream << '[' 
+           << get_color(Color::FG_LIGHT_RED) << "ERROR" << get_color(Color::FG_DEFAULT)
+           << "]: "
+           <<  msg << std::endl;
+}
+
+// appends 'chars' escaped for a JSON string (without the quotes)
+inline void append_json(std::string& out, std::string_view chars)
+{
+    static constexpr char hex[] = "0123456789abcdef";
+
+    for (const char ch: chars)
+    {
+        switch (ch)
+        {
+            case '"':  out.append("\\\""); break;
+            case '\\': out.append("\\\\"); break;
+            case '\n': out.append("\\n"); break;
+            case '\r': out.append("\\r"); break;
+            case '\t': out.append("\\t"); break;
+
+            default:
+                if ((uint8_t)ch < 0x20)
+                {
+                    out.append("\\u00");
+                    out.push_back(hex[ch >> 4]);
+                    out.push_back(hex[ch & 0xF]);
+                }
+                else
+                    out.push_back(ch);
+        }
+    }
+}
+
 [[noreturn]]
 inline void panic(const std::string& msg)
 {
-    std::cout << '[' 
-              << get_color(Color::FG_LIGHT_RED) << "ERROR" << get_color(Color::FG_DEFAULT)
-              << "]: "
-              <<  msg << std::endl;
-    
+    report_error(std::cout, msg);
     exit(1);
 }
 
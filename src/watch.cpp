@@ -0,0 +1,176 @@
+
+// built-in
+#include <algorithm>
+#include <chrono>
+#include <system_error>
+#include <thread>
+
+#ifdef __linux__
+    #include <poll.h>
+    #include <sys/inotify.h>
+    #include <unistd.h>
+    #include <cerrno>
+    #include <cstring>
+#endif
+
+// local
+#include "watch.hpp"
+#include "utils.hpp"
+
+
+namespace fs = std::filesystem;
+
+
+
+#ifdef __linux__
+
+
+FileWatcher::FileWatcher(const std::vector<std::string>& paths)
+: paths(paths)
+{
+    this->fd = inotify_init1(IN_CLOEXEC);
+    if (this->fd < 0)
+        panic("could not start watching the files");
+
+    // directories already watched, by path
+    std::unordered_map<std::string, int> directories;
+
+    for (uint32_t idx = 0; idx < paths.size(); ++idx)
+    {
+        fs::path path {paths[idx]};
+        std::string directory = path.has_parent_path() ? path.parent_path().string() : ".";
+
+        auto found = directories.find(directory);
+        if (found == directories.end())
+        {
+            // a write finishing or a file renamed into the directory (atomic saves)
+            int wd = inotify_add_watch(this->fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+            if (wd < 0)
+                panic("could not watch the directory '" + directory + "'");
+
+            found = directories.emplace(directory, wd).first;
+        }
+
+        this->watched[found->second][path.filename().string()].push_back(idx);
+    }
+}
+
+FileWatcher::~FileWatcher()
+{
+    close(this->fd);
+}
+
+
+const char* FileWatcher::wait(std::vector<uint32_t>& changed)
+{
+    changed.clear();
+    alignas(inotify_event) char buffer[16 * 1024];
+
+    // blocks for the first event, then takes the ones arriving right after it (eg, the
+    // same save notified twice or "save all" in the editor) to compile them together
+    int timeout = -1;
+
+    while (true)
+    {
+        pollfd request {this->fd, POLLIN, 0};
+        int ready = poll(&request, 1, timeout);
+
+        if (ready < 0 && errno == EINTR)
+            continue;
+
+        if (ready < 0)
+            return std::strerror(errno);
+
+        if (ready == 0)
+            break;
+
+        ssize_t size = read(this->fd, buffer, sizeof(buffer));
+
+        if (size < 0 && (errno == EINTR || errno == EAGAIN))
+            continue;
+
+        if (size < 0)
+            return std::strerror(errno);
+
+        if (size == 0)
+            return "the inotify descriptor was closed";
+
+        for (char* ptr = buffer; ptr < buffer + size; )
+        {
+            auto event = (const inotify_event*)ptr;
+            ptr += sizeof(inotify_event) + event->len;
+
+            // events were lost, any file may have changed
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                for (uint32_t idx = 0; idx < this->paths.size(); ++idx)
+                    changed.push_back(idx);
+                continue;
+            }
+
+            auto directory = this->watched.find(event->wd);
+            if (directory == this->watched.end() || event->len == 0)
+                continue;
+
+            auto file = directory->second.find(event->name);
+            if (file != directory->second.end())
+                changed.insert(changed.end(), file->second.begin(), file->second.end());
+        }
+
+        if (!changed.empty())
+            timeout = 2;
+    }
+
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+    return nullptr;
+}
+
+
+#else
+
+
+static fs::file_time_type write_time(const std::string& path)
+{
+    std::error_code error;
+    auto time = fs::last_write_time(path, error);
+    return error ? fs::file_time_type::min() : time;
+}
+
+
+FileWatcher::FileWatcher(const std::vector<std::string>& paths)
+: paths(paths)
+{
+    for (auto& path: paths)
+        this->last_write.push_back(write_time(path));
+}
+
+FileWatcher::~FileWatcher()
+{
+}
+
+
+const char* FileWatcher::wait(std::vector<uint32_t>& changed)
+{
+    changed.clear();
+
+    while (changed.empty())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        for (uint32_t idx = 0; idx < this->paths.size(); ++idx)
+        {
+            auto time = write_time(this->paths[idx]);
+            if (time != this->last_write[idx])
+            {
+                this->last_write[idx] = time;
+                changed.push_back(idx);
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef JTS2GD_WATCH
+#define JTS2GD_WATCH
+
+
+// built-in
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <filesystem>
+
+
+//
+//  FileWatcher
+//
+//
+//  Waits for changes in a set of files, used by the watch mode
+//  to recompile only the files saved since the last compilation.
+//
+//  On Linux the parent directories of the files are watched with
+//  inotify (watching the files themselves would miss editors that
+//  save by writing a new file and renaming it over the old one).
+//  Elsewhere the modification times are polled.
+//
+//  If the kernel drops events (its queue overflowed), there is no way
+//  to know which files changed, so all of them are reported.
+//
+
+
+class FileWatcher
+{
+    private:
+
+        std::vector<std::string> paths;
+
+#ifdef __linux__
+        int fd = -1;
+
+        // watch descriptor of a directory -> (file name -> indices of 'paths')
+        std::unordered_map<int, std::unordered_map<std::string, std::vector<uint32_t>>> watched;
+#else
+        std::vector<std::filesystem::file_time_type> last_write;
+#endif
+
+    public:
+
+        explicit FileWatcher(const std::vector<std::string>& paths);
+        ~FileWatcher();
+
+        FileWatcher(const FileWatcher&) = delete;
+        FileWatcher& operator=(const FileWatcher&) = delete;
+
+        //  Blocks until at least one file changes and fills 'changed' with the indices (in the
+        //  constructor order) of the changed ones. If the changes can no longer be watched,
+        //  returns the error message (otherwise nullptr).
+        const char* wait(std::vector<uint32_t>& changed);
+};
+
+
+#endif